@@ -58,6 +58,25 @@ bool isInteger(const std::string &s){
 }
 
 
+double tscPerNs(){
+	static double ratio = []{
+#if defined(__x86_64__) || defined(__i386__)
+		struct timespec t0, t1;
+		clock_gettime(CLOCK_MONOTONIC,&t0);
+		uint64_t c0 = readTSC();
+		usleep(20000);
+		clock_gettime(CLOCK_MONOTONIC,&t1);
+		uint64_t c1 = readTSC();
+		double ns = (t1.tv_sec-t0.tv_sec)*1e9+(t1.tv_nsec-t0.tv_nsec);
+		return (c1-c0)/ns;
+#else
+		return 1.0;
+#endif
+	}();
+	return ratio;
+}
+
+
 std::string machineName(){
 	char hostname[1024];
 	hostname[1023] = '\0';
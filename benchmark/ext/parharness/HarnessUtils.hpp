@@ -28,6 +28,11 @@ limitations under the License.
 #include <stdlib.h>
 #include <unistd.h>
 #include <string>
+#include <stdint.h>
+#include <time.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
 
 // UTILITY CODE -----------------------------
 void errexit (const char *err_str);
@@ -43,4 +48,18 @@ inline int64_t timeDiff(struct timeval* start, struct timeval* end){
 	ret += ((int64_t)end->tv_usec)-start->tv_usec;
 	return ret;
 }
+
+// TIMING -----------------------------------
+// reads the time stamp counter, or a nanosecond clock where there is none
+inline uint64_t readTSC(){
+#if defined(__x86_64__) || defined(__i386__)
+	return __rdtsc();
+#else
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC,&ts);
+	return (uint64_t)ts.tv_sec*1000000000ull+ts.tv_nsec;
+#endif
+}
+// readTSC() ticks per nanosecond, calibrated on the first call
+double tscPerNs();
 #endif
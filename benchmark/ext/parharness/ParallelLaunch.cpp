@@ -20,6 +20,7 @@ limitations under the License.
 
 #include "ParallelLaunch.hpp"
 #include "HarnessUtils.hpp"
+#include "PerfCounters.hpp"
 #include <atomic>
 #include <hwloc.h>
 
@@ -51,6 +52,21 @@ void alarmhandler(int sig){
 }
 
 
+// TIMER ------------------------------------------------
+// raises gtc->stop at gtc->finish, so that the test loops
+// need not read the clock after every operation
+pthread_t timer;
+static void * timer_main(void *lp){
+	GlobalTestConfig* gtc = (GlobalTestConfig*) lp;
+	struct timespec deadline;
+	deadline.tv_sec = gtc->finish.tv_sec;
+	deadline.tv_nsec = gtc->finish.tv_usec*1000;
+	while(clock_nanosleep(CLOCK_REALTIME,TIMER_ABSTIME,&deadline,NULL)==EINTR);
+	gtc->stop.store(true,std::memory_order_release);
+	return NULL;
+}
+
+
 // AFFINITY ----------------------------------------------
 
 /*
@@ -78,6 +94,12 @@ void initTest(GlobalTestConfig* gtc){
 	mallopt(M_TRIM_THRESHOLD, -1);	
   	mallopt(M_MMAP_MAX, 0);
 	gtc->test->init(gtc);
+	tscPerNs(); // calibrate before any thread starts timing
+	if(gtc->getEnv("perf")=="1"){
+		for(int i = 0; i<PerfCounters::EVENTS; i++){
+			gtc->recorder->addThreadField(PerfCounters::name(i),&PerfCounters::perOp);
+		}
+	}
 	for(int i = 0; i<gtc->allocatedRideables.size() && gtc->getEnv("report")=="1"; i++){
 		if(Reportable* r = dynamic_cast<Reportable*>(gtc->allocatedRideables[i])){
 			r->introduce();
@@ -116,12 +138,26 @@ static void * thread_main (void *lp)
 	int task_id = ltc->tid;
 	setAffinity(gtc,ltc);
 
+	gtc->test->parInit(gtc,ltc); // per-thread setup, e.g. prefill
+
+	PerfCounters counters;
+	bool perf = gtc->getEnv("perf")=="1";
+	if(perf && counters.open()==0 && task_id==0){
+		fprintf(stderr,"perf_event_open failed, hardware counters not recorded.\n");
+	}
+
 	barrier(); // barrier all threads before setting times
 
 	if(task_id==0){
         	gettimeofday (&gtc->start, NULL);
         	gtc->finish=gtc->start;
 			gtc->finish.tv_sec+=gtc->interval;
+			gtc->stop.store(false);
+			pthread_create(&timer, NULL, timer_main, gtc);
+			if(gtc->timeOut){
+				// armed only now, so a slow parInit() is not a time out
+				alarm(gtc->interval+10);  // set an alarm for interval+10 seconds from now
+			}
 	}
 
 
@@ -129,13 +165,21 @@ static void * thread_main (void *lp)
 	barrier(); // barrier all threads before starting
 
 	/* ------- WE WILL DO ALL OF THE WORK!!! ---------*/
+	if(perf){counters.start();}
 	int ops = executeTest(gtc,ltc);
+	if(perf){counters.stop();}
 
 	// record standard statistics
 	__sync_fetch_and_add (&gtc->total_operations, ops);
 	gtc->recorder->reportThreadInfo("ops",ops,ltc->tid);
 	gtc->recorder->reportThreadInfo("ops_stddev",ops,ltc->tid);
 	gtc->recorder->reportThreadInfo("ops_each",ops,ltc->tid);
+	for(int i = 0; perf && i<PerfCounters::EVENTS; i++){
+		uint64_t count;
+		std::string s = counters.read(i,&count)?
+			std::to_string(count)+":"+std::to_string(ops) : "";
+		gtc->recorder->reportThreadInfo(PerfCounters::name(i),s,ltc->tid);
+	}
 
 	barrier(); // barrier all threads at end
 
@@ -173,9 +217,6 @@ void parallelWork(GlobalTestConfig* gtc){
 	}
 
 	signal(SIGALRM, &alarmhandler);  // set a signal handler
-	if(gtc->timeOut){
-		alarm(gtc->interval+10);  // set an alarm for interval+10 seconds from now
-	}
 
 	atomic_thread_fence(std::memory_order::memory_order_acq_rel);
 
@@ -193,6 +234,7 @@ void parallelWork(GlobalTestConfig* gtc){
 	// join threads ------------------
 	for (i = 1; i < task_num; i++)
     	pthread_join (threads[i], NULL);
+	pthread_join (timer, NULL);
 
 	for (i = 0; i < task_num; i++) {
 		delete ctcs[i].ltc;
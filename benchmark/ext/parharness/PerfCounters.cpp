@@ -0,0 +1,145 @@
+/*
+
+Copyright 2015 University of Rochester
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License. 
+
+*/
+
+
+
+#include "PerfCounters.hpp"
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+
+using namespace std;
+
+// cycles, instructions, last-level cache misses, and loads served by
+// another NUMA node
+static const uint32_t types[PerfCounters::EVENTS] = {
+	PERF_TYPE_HARDWARE,
+	PERF_TYPE_HARDWARE,
+	PERF_TYPE_HARDWARE,
+	PERF_TYPE_HW_CACHE
+};
+static const uint64_t configs[PerfCounters::EVENTS] = {
+	PERF_COUNT_HW_CPU_CYCLES,
+	PERF_COUNT_HW_INSTRUCTIONS,
+	PERF_COUNT_HW_CACHE_MISSES,
+	PERF_COUNT_HW_CACHE_NODE | (PERF_COUNT_HW_CACHE_OP_READ<<8) | (PERF_COUNT_HW_CACHE_RESULT_MISS<<16)
+};
+static const char* const names[PerfCounters::EVENTS] = {
+	"cycles_per_op",
+	"instructions_per_op",
+	"llc_misses_per_op",
+	"remote_accesses_per_op"
+};
+
+PerfCounters::PerfCounters(){
+	for(int i = 0; i<EVENTS; i++){
+		fds[i] = -1;
+	}
+}
+
+PerfCounters::~PerfCounters(){
+	for(int i = 0; i<EVENTS; i++){
+		if(fds[i]>=0){
+			close(fds[i]);
+		}
+	}
+}
+
+int PerfCounters::open(){
+	int opened = 0;
+	for(int i = 0; i<EVENTS; i++){
+		struct perf_event_attr attr;
+		memset(&attr,0,sizeof(attr));
+		attr.size = sizeof(attr);
+		attr.type = types[i];
+		attr.config = configs[i];
+		attr.disabled = 1;
+		attr.exclude_kernel = 1;
+		attr.exclude_hv = 1;
+		attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+		fds[i] = syscall(__NR_perf_event_open,&attr,0,-1,-1,0);
+		if(fds[i]>=0){
+			opened++;
+		}
+	}
+	return opened;
+}
+
+void PerfCounters::start(){
+	for(int i = 0; i<EVENTS; i++){
+		if(fds[i]>=0){
+			ioctl(fds[i],PERF_EVENT_IOC_RESET,0);
+			ioctl(fds[i],PERF_EVENT_IOC_ENABLE,0);
+		}
+	}
+}
+
+void PerfCounters::stop(){
+	for(int i = 0; i<EVENTS; i++){
+		if(fds[i]>=0){
+			ioctl(fds[i],PERF_EVENT_IOC_DISABLE,0);
+		}
+	}
+}
+
+bool PerfCounters::read(int i, uint64_t* count){
+	// value, time enabled, time running
+	uint64_t buf[3];
+	if(fds[i]<0 || ::read(fds[i],buf,sizeof(buf))!=sizeof(buf)){
+		return false;
+	}
+	if(buf[2]==0){
+		*count = 0;
+	}
+	else if(buf[2]<buf[1]){
+		*count = (uint64_t)((double)buf[0]*buf[1]/buf[2]);
+	}
+	else{
+		*count = buf[0];
+	}
+	return true;
+}
+
+const char* PerfCounters::name(int i){
+	return names[i];
+}
+
+string PerfCounters::perOp(list<string> list){
+	double count = 0;
+	double ops = 0;
+	bool any = false;
+	for(string s : list){
+		size_t colon = s.find(':');
+		if(colon==string::npos){
+			continue;
+		}
+		count += atof(s.substr(0,colon).c_str());
+		ops += atof(s.substr(colon+1).c_str());
+		any = true;
+	}
+	if(!any || ops==0){
+		return "NA";
+	}
+	char buff[32];
+	snprintf(buff,sizeof(buff),"%f",count/ops);
+	return string(buff);
+}
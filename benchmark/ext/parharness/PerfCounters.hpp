@@ -0,0 +1,61 @@
+/*
+
+Copyright 2015 University of Rochester
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License. 
+
+*/
+
+
+
+#ifndef PERF_COUNTERS_HPP
+#define PERF_COUNTERS_HPP
+
+#include <list>
+#include <string>
+#include <stdint.h>
+
+// HARDWARE COUNTERS ------------------------
+// Per-thread hardware counters around the timed phase, enabled with
+// -d perf=1.  Each event is opened on its own for the calling thread,
+// user space only, so that whichever events the machine and
+// perf_event_paranoid allow are still counted when others are not.
+// Counts are scaled for multiplexing.
+class PerfCounters{
+public:
+	static const int EVENTS = 4;
+
+	PerfCounters();
+	~PerfCounters();
+
+	// opens the events for the calling thread, disabled
+	// returns : the number of events opened
+	int open();
+	void start();
+	void stop();
+	// returns : false if event i could not be opened
+	bool read(int i, uint64_t* count);
+
+	// column name of event i
+	static const char* name(int i);
+
+	// Recorder summary function: each thread reports "count:ops", or
+	// "" when the event is not available; returns the summed count
+	// over the summed ops, or NA when no thread counted the event
+	static std::string perOp(std::list<std::string> list);
+
+private:
+	int fds[EVENTS];
+};
+
+#endif
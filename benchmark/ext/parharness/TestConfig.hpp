@@ -23,6 +23,7 @@ limitations under the License.
 
 #include <string.h>
 #include <vector>
+#include <atomic>
 #include <map>
 #include <unistd.h>
 #include <iostream>
@@ -55,6 +56,7 @@ class GlobalTestConfig{
 public:
 	int task_num = 4;  // number of threads
 	struct timeval start, finish; // timing structures
+	std::atomic<bool> stop{false}; // raised by the timer thread at finish
 	long unsigned int interval = 2;  // number of seconds to run test
 
 	std::vector<hwloc_obj_t> affinities; // map from tid to CPU id
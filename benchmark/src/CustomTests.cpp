@@ -78,3 +78,172 @@ int DebugTest::execute(GlobalTestConfig* gtc, LocalTestConfig* ltc){
 
 
 
+
+
+void TrackerBenchTest::init(GlobalTestConfig* gtc){
+	slots = gtc->checkEnv("slots")? atoi((gtc->getEnv("slots")).c_str()) : 3;
+	cells_num = gtc->checkEnv("cells")? atoi((gtc->getEnv("cells")).c_str()) : 1024;
+	if (slots < 1 || cells_num < 1){
+		errexit("TrackerBenchTest needs at least one slot and one cell.");
+	}
+	int epochf = gtc->getEnv("epochf").empty()? 150:stoi(gtc->getEnv("epochf"));
+	int emptyf = gtc->getEnv("emptyf").empty()? 30:stoi(gtc->getEnv("emptyf"));
+	// SCAN calls empty() itself, so retire() must not
+	tracker = new MemoryTracker<TrackerBenchNode>(gtc, epochf, emptyf, slots, mode!=SCAN);
+
+	cells = new std::atomic<TrackerBenchNode*>[cells_num];
+	for (int i = 0; i < cells_num; i++){
+		cells[i].store(mkNode(0));
+	}
+
+	// add fields in records:
+	switch(mode){
+	case READ:
+		gtc->recorder->addThreadField("read_ns", &TrackerBenchTest::meanNs);
+		break;
+	case STALE_READ:
+		gtc->recorder->addThreadField("stale_read_ns", &TrackerBenchTest::meanNs);
+		gtc->recorder->addThreadField("slow_paths", &Recorder::sumInt64s);
+		break;
+	case RETIRE:
+		gtc->recorder->addThreadField("retire_ns", &TrackerBenchTest::meanNs);
+		break;
+	case SCAN:
+		gtc->recorder->addThreadField("empty_ns", &TrackerBenchTest::meanNs);
+		break;
+	case ALLOC:
+		gtc->recorder->addThreadField("alloc_ns", &TrackerBenchTest::meanNs);
+		gtc->recorder->addThreadField("reclaim_ns", &TrackerBenchTest::meanNs);
+		break;
+	}
+	if(gtc->verbose){
+		cout<<"Tracker:"<<gtc->getEnv("tracker")<<" Slots:"<<slots<<" Cells:"<<cells_num<<endl;
+	}
+}
+
+TrackerBenchNode* TrackerBenchTest::mkNode(int tid){
+	void* ptr = tracker->alloc(tid);
+	return new (ptr) TrackerBenchNode();
+}
+
+int TrackerBenchTest::execute(GlobalTestConfig* gtc, LocalTestConfig* ltc){
+	int tid = ltc->tid;
+	int ops = 0;
+	uint64_t ticks = 0;
+	uint64_t ticks2 = 0;
+	uint64_t t0;
+	std::mt19937_64 gen(ltc->seed);
+	TrackerBenchNode* batch[BATCH];
+	int idx[BATCH];
+	// groups of one read per slot, each after an epoch advance
+	int groups = BATCH/slots>0? BATCH/slots : 1;
+
+	while(!gtc->stop.load(std::memory_order_relaxed)){
+		switch(mode){
+		case READ:
+			for (int i = 0; i < BATCH; i++){
+				idx[i] = gen()%cells_num;
+			}
+			tracker->start_op(tid);
+			t0 = readTSC();
+			for (int i = 0; i < BATCH; i++){
+				tracker->read(cells[idx[i]], i%slots, tid, NULL);
+			}
+			ticks += readTSC()-t0;
+			tracker->end_op(tid);
+			ops += BATCH;
+			break;
+		case STALE_READ:
+			tracker->start_op(tid);
+			for (int g = 0; g < groups; g++){
+				for (int j = 0; j < slots; j++){
+					idx[j%BATCH] = gen()%cells_num;
+				}
+				tracker->advance_epoch(tid);
+				t0 = readTSC();
+				for (int j = 0; j < slots; j++){
+					tracker->read(cells[idx[j%BATCH]], j, tid, NULL);
+				}
+				ticks += readTSC()-t0;
+			}
+			tracker->end_op(tid);
+			ops += groups*slots;
+			break;
+		case RETIRE:
+			for (int i = 0; i < BATCH; i++){
+				batch[i] = mkNode(tid);
+			}
+			t0 = readTSC();
+			for (int i = 0; i < BATCH; i++){
+				tracker->retire(batch[i], tid);
+			}
+			ticks += readTSC()-t0;
+			ops += BATCH;
+			break;
+		case SCAN:
+			for (int i = 0; i < BATCH; i++){
+				tracker->retire(mkNode(tid), tid);
+			}
+			t0 = readTSC();
+			tracker->empty(tid);
+			ticks += readTSC()-t0;
+			ops += BATCH;
+			break;
+		case ALLOC:
+			t0 = readTSC();
+			for (int i = 0; i < BATCH; i++){
+				batch[i] = mkNode(tid);
+			}
+			ticks += readTSC()-t0;
+			t0 = readTSC();
+			for (int i = 0; i < BATCH; i++){
+				tracker->reclaim(batch[i]);
+			}
+			ticks2 += readTSC()-t0;
+			ops += BATCH;
+			break;
+		}
+	}
+
+	switch(mode){
+	case READ:
+		report(gtc, "read_ns", ticks, ops, tid);
+		break;
+	case STALE_READ:
+		report(gtc, "stale_read_ns", ticks, ops, tid);
+		gtc->recorder->reportThreadInfo("slow_paths", (int64_t)tracker->slow_paths(tid), tid);
+		break;
+	case RETIRE:
+		report(gtc, "retire_ns", ticks, ops, tid);
+		break;
+	case SCAN:
+		report(gtc, "empty_ns", ticks, ops, tid);
+		break;
+	case ALLOC:
+		report(gtc, "alloc_ns", ticks, ops, tid);
+		report(gtc, "reclaim_ns", ticks2, ops, tid);
+		break;
+	}
+	return ops;
+}
+
+void TrackerBenchTest::report(GlobalTestConfig* gtc, const char* field, uint64_t ticks, uint64_t calls, int tid){
+	gtc->recorder->reportThreadInfo(field, to_string(ticks)+":"+to_string(calls), tid);
+}
+
+string TrackerBenchTest::meanNs(list<string> list){
+	double ticks = 0;
+	double calls = 0;
+	for(string s : list){
+		size_t colon = s.find(':');
+		if(colon==string::npos){
+			continue;
+		}
+		ticks += atof(s.substr(0,colon).c_str());
+		calls += atof(s.substr(colon+1).c_str());
+	}
+	if(calls==0){
+		return "NA";
+	}
+	return to_string(ticks/calls/tscPerNs());
+}
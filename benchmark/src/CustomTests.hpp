@@ -24,8 +24,204 @@ limitations under the License.
 #include "RUnorderedMap.hpp"
 #include "ROrderedMap.hpp"
 #include "RetiredMonitorable.hpp"
+#include "LatencyHistogram.hpp"
+#include "OpStream.hpp"
+#include "TimeSeries.hpp"
+#include "Snapshot.hpp"
+#include <algorithm>
 #include <map>
 #include <random>
+#include <vector>
+
+/*
+ * Allocates the rideable and casts it to the interface R a test runs
+ * on; with monitored, it must be RetiredMonitorable as well. Exits
+ * naming the test otherwise.
+ */
+template <class R>
+R* allocRideableAs(GlobalTestConfig* gtc, const std::string& test, const std::string& type, bool monitored){
+	Rideable* ptr = gtc->allocRideable();
+	if (monitored && !dynamic_cast<RetiredMonitorable*>(ptr)){
+		errexit((test+" must be run on RetiredMonitorable type object.").c_str());
+	}
+	R* r = dynamic_cast<R*>(ptr);
+	if (!r) {
+		errexit((test+" must be run on "+type+" type object.").c_str());
+	}
+	return r;
+}
+
+// key v of the tests; zero-padded for strings, so that string order
+// is numeric order
+template <class T>
+inline T orderedKey(uint64_t v){
+	return (T)v;
+}
+
+template<>
+inline std::string orderedKey<std::string>(uint64_t v){
+	char buf[24];
+	snprintf(buf,sizeof(buf),"%012lu",v);
+	return std::string(buf);
+}
+
+/*
+ * Prefill shared by the map tests. keys holds the schedule: the first
+ * prefill draws of mt19937_64(1) modulo range, in draw order. By
+ * default parInit() has every worker put one contiguous slice of it,
+ * so nodes come from all threads' allocators and the final contents
+ * do not depend on timing. With -d bulk=1, schedule() bulk-loads the
+ * sorted keys instead. With -d snapshot=<file>, an existing file is
+ * loaded in place of the prefill, and a missing one is written from
+ * the live map by the last thread to finish parInit(), reading back
+ * every scheduled key.
+ */
+template <class T>
+class Prefill{
+	std::string snapshot;
+	int range = 0;
+	int prefill = 0;
+	std::vector<T> dump_keys;
+	std::atomic<int> finished{0};
+
+	void dump(GlobalTestConfig* gtc, RUnorderedMap<T,T>* m, int tid){
+		std::vector<T> present, vals;
+		for(const T& k : dump_keys){
+			optional<T> v = m->get(k,tid);
+			if(v.has_value()){
+				present.push_back(k);
+				vals.push_back(v.value());
+			}
+		}
+		Snapshot<T,T>::write(snapshot,present.data(),vals.data(),present.size(),range,prefill);
+		dump_keys.clear();
+		if(gtc->verbose){
+			printf("Prefill: %lu keys saved to %s\n",present.size(),snapshot.c_str());
+		}
+	}
+
+public:
+	std::vector<T> keys;
+
+	// -d range and -d prefill override the constructor arguments
+	static void overrideSizes(GlobalTestConfig* gtc, int& range, int& prefill){
+		if(gtc->checkEnv("range")){
+			range = atoi((gtc->getEnv("range")).c_str());
+		}
+		if(gtc->checkEnv("prefill")){
+			prefill = atoi((gtc->getEnv("prefill")).c_str());
+		}
+	}
+
+	// draws the schedule, keys made by fromInt, and sets up the load
+	template <class F>
+	void schedule(GlobalTestConfig* gtc, RUnorderedMap<T,T>* m, int range, int prefill, F fromInt){
+		this->range = range;
+		this->prefill = prefill;
+		std::mt19937_64 gen(1);
+		keys.reserve(prefill);
+		for(int i = 0; i<prefill; i++){
+			keys.push_back(fromInt(gen()%range));
+		}
+		load(gtc,m);
+	}
+
+	void load(GlobalTestConfig* gtc, RUnorderedMap<T,T>* m){
+		snapshot = gtc->getEnv("snapshot");
+		if(snapshot!="" && Snapshot<T,T>::exists(snapshot)){
+			size_t n = Snapshot<T,T>::load(snapshot,m,gtc->task_num,range,prefill);
+			keys.clear();
+			if(gtc->verbose){
+				printf("Prefill: %lu keys loaded from %s\n",n,snapshot.c_str());
+			}
+			snapshot = "";
+			return;
+		}
+		if(snapshot!=""){
+			// the dump must not disturb the draw order parInit() uses
+			dump_keys = keys;
+			std::sort(dump_keys.begin(),dump_keys.end());
+			dump_keys.erase(std::unique(dump_keys.begin(),dump_keys.end()),dump_keys.end());
+		}
+		if(gtc->getEnv("bulk")=="1"){
+			std::sort(keys.begin(),keys.end());
+			keys.erase(std::unique(keys.begin(),keys.end()),keys.end());
+			m->bulkLoad(keys.data(),keys.data(),keys.size(),gtc->task_num);
+			keys.clear();
+		}
+		if(gtc->verbose){
+			printf("Prefill: %lu keys over %d threads\n",keys.size(),gtc->task_num);
+		}
+	}
+	void parInit(GlobalTestConfig* gtc, LocalTestConfig* ltc, RUnorderedMap<T,T>* m){
+		size_t n = keys.size();
+		int tid = ltc->tid;
+		for(size_t i = n*tid/gtc->task_num; i<n*(tid+1)/gtc->task_num; i++){
+			m->put(keys[i],keys[i],tid);
+		}
+		if(snapshot!="" && finished.fetch_add(1)+1==gtc->task_num){
+			dump(gtc,m,tid);
+		}
+	}
+};
+
+// operation types of the map tests, in the order of their proportions
+static const std::vector<std::string> MAP_OPS = {"get","replace","put","insert","remove"};
+
+/*
+ * With -d batch=<n>, a map test thread queues its gets and issues them
+ * n at a time through multiGet(), which is all the timed loop does with
+ * them. Once the threads are done, cleanup() runs verify(), which looks
+ * up every key of the range through multiGet() and get() and ends the
+ * run if the two disagree.
+ */
+template <class T>
+class GetBatch{
+	RUnorderedMap<T,T>* m;
+	size_t size;
+	std::vector<T> keys;
+	std::vector<optional<T>> results;
+public:
+	GetBatch(RUnorderedMap<T,T>* m, int size):
+	 m(m),size(size>0? size : 0){
+		keys.reserve(this->size);
+		results.resize(this->size);
+	}
+	bool enabled(){return size>0;}
+
+	// queues k, and issues the batch once it is full
+	void add(const T& k, int tid){
+		keys.push_back(k);
+		if(keys.size()==size){
+			flush(tid);
+		}
+	}
+	void flush(int tid){
+		m->multiGet(keys.data(),results.data(),keys.size(),tid);
+		keys.clear();
+	}
+
+	// with the map quiescent, checks multiGet() against get() on the
+	// keys fromInt(0) ... fromInt(range-1)
+	template <class F>
+	void verify(int range, F fromInt, int tid){
+		for(int first = 0; first<range; first+=size){
+			for(int i = first; i<range && i<first+(int)size; i++){
+				keys.push_back(fromInt(i));
+			}
+			m->multiGet(keys.data(),results.data(),keys.size(),tid);
+			for(size_t i = 0; i<keys.size(); i++){
+				optional<T> single = m->get(keys[i],tid);
+				if(results[i].has_value()!=single.has_value()
+				 || (single.has_value() && single.value()!=results[i].value())){
+					errexit("multiGet and get disagree.");
+				}
+			}
+			keys.clear();
+		}
+	}
+};
+
 template <class T>
 class MapChurnTest : public Test{
 public:
@@ -34,6 +230,13 @@ public:
 	int prop_gets, prop_replaces, prop_puts, prop_inserts, prop_removes;
 	int range;
 	int prefill;
+	int latency;
+	int stream;
+	int batch;
+	KeyDistribution dist;
+	Prefill<T> prefiller;
+	TimeSeries series;
+	std::vector<OpStream<T>*> streams;
 
 	inline T fromInt(uint64_t v);
 	
@@ -41,9 +244,23 @@ public:
 	MapChurnTest(int p_gets, int p_replaces, int p_puts, int p_inserts, int p_removes, int range):
 		MapChurnTest(p_gets, p_replaces, p_puts, p_inserts, p_removes, range,0){}
 	void init(GlobalTestConfig* gtc);
-	void parInit(GlobalTestConfig* gtc, LocalTestConfig* ltc){}
+	void parInit(GlobalTestConfig* gtc, LocalTestConfig* ltc){
+		prefiller.parInit(gtc,ltc,m);
+		if(stream>0){
+			streams[ltc->tid] = new OpStream<T>(stream,ltc->seed,dist,
+				dist.start(ltc->tid,gtc->task_num),
+				[this](uint64_t v){return this->fromInt(v);});
+		}
+	}
 	int execute(GlobalTestConfig* gtc, LocalTestConfig* ltc);
-	void cleanup(GlobalTestConfig* gtc){}
+	void cleanup(GlobalTestConfig* gtc){
+		for(OpStream<T>* s : streams){
+			delete s;
+		}
+		if(batch>0){
+			GetBatch<T>(m,batch).verify(range,[this](uint64_t v){return this->fromInt(v);},0);
+		}
+	}
 };
 
 template <class T>
@@ -73,11 +290,8 @@ MapChurnTest<T>::MapChurnTest(int p_gets, int p_replaces, int p_puts,
 
 template <class T>
 void MapChurnTest<T>::init(GlobalTestConfig* gtc){
-	Rideable* ptr = gtc->allocRideable();
-	this->m = dynamic_cast<RUnorderedMap<T,T>*>(ptr);
-	if (!m) {
-		 errexit("MapChurnTest must be run on RUnorderedMap<T,T> type object.");
-	}
+	this->m = allocRideableAs<RUnorderedMap<T,T>>(gtc,"MapChurnTest","RUnorderedMap<T,T>",false);
+	series.init(gtc,m);
 	
 	if(gtc->verbose){
 		printf("Gets:%d Replaces:%d Puts:%d Inserts:%d Removes: %d\n",
@@ -85,27 +299,23 @@ void MapChurnTest<T>::init(GlobalTestConfig* gtc){
 	}
 	
 	// overrides for constructor arguments
-	if(gtc->checkEnv("range")){
-		range = atoi((gtc->getEnv("range")).c_str());
-	}
-	if(gtc->checkEnv("prefill")){
-		prefill = atoi((gtc->getEnv("prefill")).c_str());
+	Prefill<T>::overrideSizes(gtc,range,prefill);
+	latency = gtc->checkEnv("latency")? atoi((gtc->getEnv("latency")).c_str()) : 0;
+	if(latency>0){
+		LatencySampler::addFields(gtc,MAP_OPS);
 	}
-
-	// prefill
-	int i = 0;
-	uint64_t r = 1;
-	std::mt19937_64 gen(1);
-	for(i = 0; i<prefill; i++){
-		// r = nextRand(r);
-		r = gen();
-		T k = this->fromInt(r%range);
-		T val = k;
-		m->put(k,val,0);
-}
+	// with -d stream=<n>, each thread replays n pre-generated ops
+	stream = gtc->checkEnv("stream")? atoi((gtc->getEnv("stream")).c_str()) : 0;
+	streams.assign(gtc->task_num,NULL);
+	// with -d batch=<n>, gets go through multiGet n at a time
+	batch = gtc->checkEnv("batch")? atoi((gtc->getEnv("batch")).c_str()) : 0;
+	dist = KeyDistribution(gtc->getEnv("dist"),range);
 	if(gtc->verbose){
-		printf("Prefilled %d\n",i);
+		printf("Key distribution: %s\n",dist.describe().c_str());
 	}
+
+	// prefill schedule, run by parInit
+	prefiller.schedule(gtc,m,range,prefill,[this](uint64_t v){return this->fromInt(v);});
 }
 
 template <class T>
@@ -120,44 +330,77 @@ inline std::string MapChurnTest<std::string>::fromInt(uint64_t v){
 
 template <class T>
 int MapChurnTest<T>::MapChurnTest::execute(GlobalTestConfig* gtc, LocalTestConfig* ltc){
-	struct timeval time_up = gtc->finish;
-	struct timeval now;
-	gettimeofday(&now,NULL);
 	int ops = 0;
 	uint64_t r = ltc->seed;
 	std::mt19937_64 gen_k(r);
 	std::mt19937_64 gen_p(r+1);
 	int tid = ltc->tid;
+	series.start(tid);
+	LatencySampler sampler(latency,MAP_OPS.size());
+	OpStream<T>* replay = streams[tid];
+	GetBatch<T> gets(m,batch);
+	T drawn;
+	uint64_t counter = dist.start(tid,gtc->task_num);
 
 	//broker->threadInit(gtc,ltc);
 
-	while(timeDiff(&now,&time_up)>0){
+	while(!gtc->stop.load(std::memory_order_relaxed)){
 		// r = nextRand(r);
-		r = gen_k();
-		T k = this->fromInt(r%range);
-		T val = k;
+		const T* kp;
+		int p;
+		if(replay!=NULL){
+			kp = &replay->next(p);
+		}
+		else{
+			r = dist.next(gen_k,counter);
+			drawn = this->fromInt(r);
+			p = gen_p()%100;
+			kp = &drawn;
+		}
+		const T& k = *kp;
+		const T& val = k;
 
-		int p = gen_p()%100;
+		int op;
+		bool timed = sampler.sample();
+		uint64_t start = timed? LatencySampler::now() : 0;
 
-		if(p<prop_gets){
+		if(p<prop_gets && gets.enabled()){
+			gets.add(k,tid);
+			op = 0;
+			timed = false; // batched gets are not sampled one by one
+		}
+		else if(p<prop_gets){
 			m->get(k,tid);
+			op = 0;
 		}
 		else if(p<prop_replaces){
 			auto old = m->replace(k,val,tid);
+			op = 1;
 		}
 		else if(p<prop_puts){
 			auto old = m->put(k,val,tid);
+			op = 2;
 		}
 		else if(p<prop_inserts){
 			m->insert(k,val,tid);
+			op = 3;
 		}
 		else{ // p<=prop_removes
 			m->remove(k,tid);
+			op = 4;
 		}
 
+		if(timed){
+			sampler.record(op,start);
+		}
 		ops++;
-		gettimeofday(&now,NULL);
+		series.progress(tid,ops);
+	}
+	if(gets.enabled()){
+		gets.flush(tid); // the gets still queued were counted
 	}
+	sampler.report(gtc,MAP_OPS,tid);
+	series.finish(tid);
 	return ops;
 }
 
@@ -169,6 +412,13 @@ public:
 	int prop_gets, prop_replaces, prop_puts, prop_inserts, prop_removes;
 	int range;
 	int prefill;
+	int latency;
+	int stream;
+	int batch;
+	KeyDistribution dist;
+	Prefill<T> prefiller;
+	TimeSeries series;
+	std::vector<OpStream<T>*> streams;
 
 	inline T fromInt(uint64_t v);
 	
@@ -176,9 +426,23 @@ public:
 	ObjRetireTest(int p_gets, int p_replaces, int p_puts, int p_inserts, int p_removes, int range):
 		ObjRetireTest(p_gets, p_replaces, p_puts, p_inserts, p_removes, range,0){}
 	void init(GlobalTestConfig* gtc);
-	void parInit(GlobalTestConfig* gtc, LocalTestConfig* ltc){}
+	void parInit(GlobalTestConfig* gtc, LocalTestConfig* ltc){
+		prefiller.parInit(gtc,ltc,m);
+		if(stream>0){
+			streams[ltc->tid] = new OpStream<T>(stream,ltc->seed,dist,
+				dist.start(ltc->tid,gtc->task_num),
+				[this](uint64_t v){return this->fromInt(v);});
+		}
+	}
 	int execute(GlobalTestConfig* gtc, LocalTestConfig* ltc);
-	void cleanup(GlobalTestConfig* gtc){}
+	void cleanup(GlobalTestConfig* gtc){
+		for(OpStream<T>* s : streams){
+			delete s;
+		}
+		if(batch>0){
+			GetBatch<T>(m,batch).verify(range,[this](uint64_t v){return this->fromInt(v);},0);
+		}
+	}
 };
 
 template <class T>
@@ -208,14 +472,8 @@ ObjRetireTest<T>::ObjRetireTest(int p_gets, int p_replaces, int p_puts,
 
 template <class T>
 void ObjRetireTest<T>::init(GlobalTestConfig* gtc){
-	Rideable* ptr = gtc->allocRideable();
-	if (!dynamic_cast<RetiredMonitorable*>(ptr)){
-		errexit("ObjRetireTest must be run on RetiredMonitorable type object.");
-	}
-	this->m = dynamic_cast<RUnorderedMap<T,T>*>(ptr);
-	if (!m) {
-		 errexit("ObjRetireTest must be run on RUnorderedMap<T,T> type object.");
-	}
+	this->m = allocRideableAs<RUnorderedMap<T,T>>(gtc,"ObjRetireTest","RUnorderedMap<T,T>",true);
+	series.init(gtc,m);
 	
 	if(gtc->verbose){
 		printf("Gets:%d Replaces:%d Puts:%d Inserts:%d Removes: %d\n",
@@ -223,30 +481,26 @@ void ObjRetireTest<T>::init(GlobalTestConfig* gtc){
 	}
 	
 	// overrides for constructor arguments
-	if(gtc->checkEnv("range")){
-		range = atoi((gtc->getEnv("range")).c_str());
+	Prefill<T>::overrideSizes(gtc,range,prefill);
+	latency = gtc->checkEnv("latency")? atoi((gtc->getEnv("latency")).c_str()) : 0;
+	if(latency>0){
+		LatencySampler::addFields(gtc,MAP_OPS);
 	}
-	if(gtc->checkEnv("prefill")){
-		prefill = atoi((gtc->getEnv("prefill")).c_str());
+	// with -d stream=<n>, each thread replays n pre-generated ops
+	stream = gtc->checkEnv("stream")? atoi((gtc->getEnv("stream")).c_str()) : 0;
+	streams.assign(gtc->task_num,NULL);
+	// with -d batch=<n>, gets go through multiGet n at a time
+	batch = gtc->checkEnv("batch")? atoi((gtc->getEnv("batch")).c_str()) : 0;
+	dist = KeyDistribution(gtc->getEnv("dist"),range);
+	if(gtc->verbose){
+		printf("Key distribution: %s\n",dist.describe().c_str());
 	}
 
 	// add a field in records:
 	gtc->recorder->addThreadField("obj_retired", &Recorder::sumInt64s);
 
-	// prefill
-	int i = 0;
-	uint64_t r = 1;
-	std::mt19937_64 gen(1);
-	for(i = 0; i<prefill; i++){
-		// r = nextRand(r);
-		r = gen();
-		T k = this->fromInt(r%range);
-		T val = k;
-		m->put(k,val,0);
-}
-	if(gtc->verbose){
-		printf("Prefilled %d\n",i);
-	}
+	// prefill schedule, run by parInit
+	prefiller.schedule(gtc,m,range,prefill,[this](uint64_t v){return this->fromInt(v);});
 }
 
 template <class T>
@@ -261,57 +515,779 @@ inline std::string ObjRetireTest<std::string>::fromInt(uint64_t v){
 
 template <class T>
 int ObjRetireTest<T>::ObjRetireTest::execute(GlobalTestConfig* gtc, LocalTestConfig* ltc){
-	struct timeval time_up = gtc->finish;
-	struct timeval now;
-	gettimeofday(&now,NULL);
 	int ops = 0;
 	uint64_t r = ltc->seed;
 	std::mt19937_64 gen_k(r);
 	std::mt19937_64 gen_p(r+1);
 	int tid = ltc->tid;
+	series.start(tid);
+	LatencySampler sampler(latency,MAP_OPS.size());
+	OpStream<T>* replay = streams[tid];
+	GetBatch<T> gets(m,batch);
+	T drawn;
+	uint64_t counter = dist.start(tid,gtc->task_num);
 
 	//broker->threadInit(gtc,ltc);
 
-	while(timeDiff(&now,&time_up)>0){
+	while(!gtc->stop.load(std::memory_order_relaxed)){
 		// r = nextRand(r);
-		r = gen_k();
-		T k = this->fromInt(r%range);
-		T val = k;
+		const T* kp;
+		int p;
+		if(replay!=NULL){
+			kp = &replay->next(p);
+		}
+		else{
+			r = dist.next(gen_k,counter);
+			drawn = this->fromInt(r);
+			p = gen_p()%100;
+			kp = &drawn;
+		}
+		const T& k = *kp;
+		const T& val = k;
 
-		int p = gen_p()%100;
+		int op;
+		bool timed = sampler.sample();
+		uint64_t start = timed? LatencySampler::now() : 0;
 
-		if(p<prop_gets){
+		if(p<prop_gets && gets.enabled()){
+			gets.add(k,tid);
+			op = 0;
+			timed = false; // batched gets are not sampled one by one
+		}
+		else if(p<prop_gets){
 			// printf("g: %lu\n", k);
 			m->get(k,tid);
+			op = 0;
 		}
 		else if(p<prop_replaces){
 			// printf("r: %lu\n", k);
 			auto old = m->replace(k,val,tid);
+			op = 1;
 		}
 		else if(p<prop_puts){
 			// printf("p: %lu\n", k);
 			auto old = m->put(k,val,tid);
+			op = 2;
 		}
 		else if(p<prop_inserts){
 			// std::cout<<"i: "<<k<<std::endl;
 			// printf("i: %lu\n", k);
 			m->insert(k,val,tid);
+			op = 3;
 		}
 		else{ // p<=prop_removes
 			// std::cout<<"r: "<<k<<std::endl;
 			// printf("r: %lu\n", k);
 			m->remove(k,tid);
+			op = 4;
+		}
+
+		if(timed){
+			sampler.record(op,start);
+		}
+		ops++;
+		series.progress(tid,ops);
+	}
+	if(gets.enabled()){
+		gets.flush(tid); // the gets still queued were counted
+	}
+	sampler.report(gtc,MAP_OPS,tid);
+
+	RetiredMonitorable* rm_ptr = dynamic_cast<RetiredMonitorable*>(m);
+	gtc->recorder->reportThreadInfo("obj_retired", rm_ptr->report_retired(ltc->tid), ltc->tid);
+	series.finish(tid);
+	return ops;
+}
+
+
+/*
+ * Adversarial key order for search trees: keys are taken in increasing
+ * order from a shared counter, and every insert of key k is followed
+ * by the remove of k-window, so the map holds a sliding window of the
+ * most recent keys. An unbalanced tree degenerates into a list here.
+ * Next to throughput, reads_per_op reports the tracker reads per op of
+ * the timed phase, which grow with the depth of the paths taken.
+ */
+template <class T>
+class SeqInsertTest : public Test{
+public:
+	RUnorderedMap<T,T>* m;
+	RetiredMonitorable* rm;
+	int window;
+	std::atomic<uint64_t> next_key;
+	std::atomic<uint64_t> total_reads;
+	std::atomic<uint64_t> total_ops;
+	TimeSeries series;
+
+	SeqInsertTest(int window):window(window),next_key(0),total_reads(0),total_ops(0){}
+	void init(GlobalTestConfig* gtc);
+	void parInit(GlobalTestConfig* gtc, LocalTestConfig* ltc){}
+	int execute(GlobalTestConfig* gtc, LocalTestConfig* ltc);
+	void cleanup(GlobalTestConfig* gtc);
+};
+
+template <class T>
+void SeqInsertTest<T>::init(GlobalTestConfig* gtc){
+	this->m = allocRideableAs<RUnorderedMap<T,T>>(gtc,"SeqInsertTest","RUnorderedMap<T,T>",true);
+	rm = dynamic_cast<RetiredMonitorable*>(m);
+	series.init(gtc,m);
+
+	// overrides for constructor arguments
+	if(gtc->checkEnv("prefill")){
+		window = atoi((gtc->getEnv("prefill")).c_str());
+	}
+
+	// add a field in records:
+	gtc->recorder->addThreadField("obj_retired", &Recorder::sumInt64s);
+
+	// prefill the first window, in order
+	uint64_t i = 0;
+	for(i = 0; i<(uint64_t)window; i++){
+		T k = orderedKey<T>(i);
+		m->insert(k,k,0);
+	}
+	next_key.store(i);
+	if(gtc->verbose){
+		printf("Prefilled %lu\n",i);
+	}
+}
+
+template <class T>
+int SeqInsertTest<T>::SeqInsertTest::execute(GlobalTestConfig* gtc, LocalTestConfig* ltc){
+	int ops = 0;
+	int tid = ltc->tid;
+	// the prefill ran on thread 0
+	uint64_t reads = rm->reads(tid);
+	series.start(tid);
+
+	while(!gtc->stop.load(std::memory_order_relaxed)){
+		uint64_t r = next_key.fetch_add(1);
+		T k = orderedKey<T>(r);
+		m->insert(k,k,tid);
+		m->remove(orderedKey<T>(r-window),tid);
+
+		ops+=2;
+		series.progress(tid,ops);
+	}
+
+	total_reads.fetch_add(rm->reads(tid)-reads);
+	total_ops.fetch_add(ops);
+	gtc->recorder->reportThreadInfo("obj_retired", rm->report_retired(ltc->tid), ltc->tid);
+	series.finish(tid);
+	return ops;
+}
+
+template <class T>
+void SeqInsertTest<T>::cleanup(GlobalTestConfig* gtc){
+	if(total_ops.load()==0){
+		gtc->recorder->reportGlobalInfo("reads_per_op",std::string("NA"));
+		return;
+	}
+	double per_op = (double)total_reads.load()/total_ops.load();
+	gtc->recorder->reportGlobalInfo("reads_per_op",per_op);
+	if(gtc->verbose){
+		printf("reads per op: %.2f\n",per_op);
+	}
+}
+
+/*
+ * Range-heavy mix for ordered maps: each op is either a scan of span
+ * consecutive keys from a random start, streamed through a counting
+ * visitor, or (with probability p_updates %) a put or remove of a
+ * random key. execute() returns the number of keys visited plus the
+ * number of updates, so the reported throughput is keys/sec.
+ */
+template <class T>
+class RangeScanTest : public Test{
+public:
+	class CountingVisitor : public RangeVisitor<T,T>{
+	public:
+		uint64_t visited = 0;
+		void visit(const T& key, const T& val){visited++;}
+	};
+
+	ROrderedMap<T,T>* m;
+	int span;
+	int p_updates;
+	int range;
+	int prefill;
+	Prefill<T> prefiller;
+	TimeSeries series;
+
+	RangeScanTest(int span, int p_updates, int range, int prefill):
+		span(span),p_updates(p_updates),range(range),prefill(prefill){}
+	void init(GlobalTestConfig* gtc);
+	void parInit(GlobalTestConfig* gtc, LocalTestConfig* ltc){
+		prefiller.parInit(gtc,ltc,m);
+	}
+	int execute(GlobalTestConfig* gtc, LocalTestConfig* ltc);
+	void cleanup(GlobalTestConfig* gtc){}
+};
+
+template <class T>
+void RangeScanTest<T>::init(GlobalTestConfig* gtc){
+	this->m = allocRideableAs<ROrderedMap<T,T>>(gtc,"RangeScanTest","ROrderedMap<T,T>",true);
+	series.init(gtc,m);
+
+	// overrides for constructor arguments
+	Prefill<T>::overrideSizes(gtc,range,prefill);
+	if(gtc->checkEnv("span")){
+		span = atoi((gtc->getEnv("span")).c_str());
+	}
+	if(gtc->verbose){
+		printf("Span:%d Updates:%d\n",span,p_updates);
+	}
+
+	// add fields in records:
+	gtc->recorder->addThreadField("range_scans", &Recorder::sumInt64s);
+	gtc->recorder->addThreadField("obj_retired", &Recorder::sumInt64s);
+
+	// prefill schedule, run by parInit
+	prefiller.schedule(gtc,m,range,prefill,orderedKey<T>);
+}
+
+template <class T>
+int RangeScanTest<T>::RangeScanTest::execute(GlobalTestConfig* gtc, LocalTestConfig* ltc){
+	uint64_t keys = 0;
+	int64_t scans = 0;
+	uint64_t r = ltc->seed;
+	std::mt19937_64 gen_k(r);
+	std::mt19937_64 gen_p(r+1);
+	int tid = ltc->tid;
+	series.start(tid);
+	CountingVisitor visitor;
+
+	while(!gtc->stop.load(std::memory_order_relaxed)){
+		r = gen_k()%range;
+		int p = gen_p()%100;
+
+		if(p<p_updates){
+			T k = orderedKey<T>(r);
+			if(p%2==0){
+				m->put(k,k,tid);
+			}
+			else{
+				m->remove(k,tid);
+			}
+			keys++;
 		}
+		else{
+			visitor.visited = 0;
+			m->rangeScan(orderedKey<T>(r),orderedKey<T>(r+span-1),&visitor,tid);
+			keys+=visitor.visited;
+			scans++;
+		}
+		series.progress(tid,keys);
+	}
+
+	RetiredMonitorable* rm_ptr = dynamic_cast<RetiredMonitorable*>(m);
+	gtc->recorder->reportThreadInfo("range_scans", scans, ltc->tid);
+	gtc->recorder->reportThreadInfo("obj_retired", rm_ptr->report_retired(ltc->tid), ltc->tid);
+	series.finish(tid);
+	return (int)keys;
+}
+
+/*
+ * Reclamation under stalled readers: threads below stalled alternate
+ * between churning like the others and sleeping for stall ms inside
+ * an operation, in the visitor of a range scan, where they hold their
+ * reservations. The other threads get, put and remove random keys.
+ * The unreclaimed memory is sampled every 10 ms (or -d sample=<ms>)
+ * into the time-series file, and its peak and the peak RSS are
+ * reported as columns.
+ */
+template <class T>
+class StallTest : public Test{
+public:
+	class StallingVisitor : public RangeVisitor<T,T>{
+	public:
+		GlobalTestConfig* gtc;
+		int stall_ms;
+		bool stalled = false;
+		void visit(const T& key, const T& val){
+			for(int i = 0; !stalled && i<stall_ms && !gtc->stop.load(std::memory_order_relaxed); i++){
+				usleep(1000);
+			}
+			stalled = true;
+		}
+	};
+
+	ROrderedMap<T,T>* m;
+	int stalled;
+	int stall_ms;
+	int range;
+	int prefill;
+	Prefill<T> prefiller;
+	TimeSeries series;
+
+	StallTest(int stalled, int stall_ms, int range, int prefill):
+		stalled(stalled),stall_ms(stall_ms),range(range),prefill(prefill){}
+	void init(GlobalTestConfig* gtc);
+	void parInit(GlobalTestConfig* gtc, LocalTestConfig* ltc){
+		prefiller.parInit(gtc,ltc,m);
+	}
+	int execute(GlobalTestConfig* gtc, LocalTestConfig* ltc);
+	void cleanup(GlobalTestConfig* gtc);
+};
 
+template <class T>
+void StallTest<T>::init(GlobalTestConfig* gtc){
+	this->m = allocRideableAs<ROrderedMap<T,T>>(gtc,"StallTest","ROrderedMap<T,T>",true);
+	series.init(gtc,m,10);
+
+	// overrides for constructor arguments
+	Prefill<T>::overrideSizes(gtc,range,prefill);
+	if(gtc->checkEnv("stalled")){
+		stalled = atoi((gtc->getEnv("stalled")).c_str());
+	}
+	if(gtc->checkEnv("stall")){
+		stall_ms = atoi((gtc->getEnv("stall")).c_str());
+	}
+	if(gtc->verbose){
+		printf("Stalled threads:%d Stall:%dms\n",stalled,stall_ms);
+	}
+
+	// add fields in records:
+	gtc->recorder->addThreadField("stalls", &Recorder::sumInt64s);
+	gtc->recorder->addThreadField("obj_retired", &Recorder::sumInt64s);
+
+	// prefill schedule, run by parInit
+	prefiller.schedule(gtc,m,range,prefill,orderedKey<T>);
+}
+
+template <class T>
+int StallTest<T>::StallTest::execute(GlobalTestConfig* gtc, LocalTestConfig* ltc){
+	int ops = 0;
+	int64_t stalls = 0;
+	uint64_t r = ltc->seed;
+	std::mt19937_64 gen_k(r);
+	std::mt19937_64 gen_p(r+1);
+	int tid = ltc->tid;
+	series.start(tid);
+	StallingVisitor visitor;
+	visitor.gtc = gtc;
+	visitor.stall_ms = stall_ms;
+	uint64_t phase = (uint64_t)(stall_ms*1e6*tscPerNs());
+	uint64_t next_stall = readTSC()+phase;
+
+	while(!gtc->stop.load(std::memory_order_relaxed)){
+		r = gen_k()%range;
+		T k = orderedKey<T>(r);
+
+		if(tid<stalled && readTSC()>=next_stall){
+			// scan until some key is visited, so the stall happens in an op
+			visitor.stalled = false;
+			m->rangeScan(k,orderedKey<T>(r+63),&visitor,tid);
+			if(visitor.stalled){
+				stalls++;
+				next_stall = readTSC()+phase;
+			}
+		}
+		else{
+			int p = gen_p()%100;
+			if(p<50){
+				m->get(k,tid);
+			}
+			else if(p<75){
+				m->put(k,k,tid);
+			}
+			else{
+				m->remove(k,tid);
+			}
+		}
 		ops++;
-		gettimeofday(&now,NULL);
+		series.progress(tid,ops);
 	}
 
 	RetiredMonitorable* rm_ptr = dynamic_cast<RetiredMonitorable*>(m);
+	gtc->recorder->reportThreadInfo("stalls", stalls, ltc->tid);
 	gtc->recorder->reportThreadInfo("obj_retired", rm_ptr->report_retired(ltc->tid), ltc->tid);
+	series.finish(tid);
+	return ops;
+}
+
+template <class T>
+void StallTest<T>::cleanup(GlobalTestConfig* gtc){
+	gtc->recorder->reportGlobalInfo("peak_unreclaimed",(long)series.peak_unreclaimed());
+	gtc->recorder->reportGlobalInfo("peak_unreclaimed_bytes",(long)series.peak_unreclaimed_bytes());
+	gtc->recorder->reportGlobalInfo("peak_rss",(long)series.peak_rss());
+}
+
+// operation types of the epoch storm test
+static const std::vector<std::string> STORM_OPS = {"get","put","remove"};
+
+/*
+ * Adversarial workload for the epoch-based trackers: threads below
+ * storms advance the tracker's epoch as fast as they can, doing what
+ * the tracker does before its own increments (WFE helps stuck readers
+ * first), while the others read a long list, so that every node read
+ * races with an epoch change. Readers also put and remove with
+ * probability p_updates %, to keep reclamation going. Meant for
+ * LinkList (-r 2) with WFE and HE; every get is timed by default
+ * (-d latency=<every>), and get_max is the worst-case read. WFE's
+ * slow-path entries and helps are reported per thread and as a rate.
+ */
+template <class T>
+class EpochStormTest : public Test{
+public:
+	RUnorderedMap<T,T>* m;
+	RetiredMonitorable* rm;
+	int storms;
+	int p_updates;
+	int range;
+	int prefill;
+	int latency;
+	Prefill<T> prefiller;
+
+	inline T fromInt(uint64_t v);
+
+	EpochStormTest(int storms, int p_updates, int range, int prefill):
+		storms(storms),p_updates(p_updates),range(range),prefill(prefill){}
+	void init(GlobalTestConfig* gtc);
+	void parInit(GlobalTestConfig* gtc, LocalTestConfig* ltc){
+		prefiller.parInit(gtc,ltc,m);
+	}
+	int execute(GlobalTestConfig* gtc, LocalTestConfig* ltc);
+	void cleanup(GlobalTestConfig* gtc);
+};
+
+template <class T>
+void EpochStormTest<T>::init(GlobalTestConfig* gtc){
+	this->m = allocRideableAs<RUnorderedMap<T,T>>(gtc,"EpochStormTest","RUnorderedMap<T,T>",true);
+	this->rm = dynamic_cast<RetiredMonitorable*>(m);
+
+	// overrides for constructor arguments
+	Prefill<T>::overrideSizes(gtc,range,prefill);
+	if(gtc->checkEnv("storms")){
+		storms = atoi((gtc->getEnv("storms")).c_str());
+	}
+	if(storms>=gtc->task_num){
+		errexit("EpochStormTest needs at least one reader thread.");
+	}
+	latency = gtc->checkEnv("latency")? atoi((gtc->getEnv("latency")).c_str()) : 1;
+	if(gtc->verbose){
+		printf("Storm threads:%d Updates:%d%%\n",storms,p_updates);
+	}
+
+	// add fields in records:
+	gtc->recorder->addThreadField("epoch_advances", &Recorder::sumInt64s);
+	gtc->recorder->addThreadField("slow_paths", &Recorder::sumInt64s);
+	gtc->recorder->addThreadField("helps", &Recorder::sumInt64s);
+	LatencySampler::addFields(gtc,STORM_OPS);
+
+	// prefill schedule, run by parInit
+	prefiller.schedule(gtc,m,range,prefill,[this](uint64_t v){return this->fromInt(v);});
+}
+
+template <class T>
+inline T EpochStormTest<T>::fromInt(uint64_t v){
+	return (T)v;
+}
+
+template<>
+inline std::string EpochStormTest<std::string>::fromInt(uint64_t v){
+	return std::to_string(v);
+}
+
+template <class T>
+int EpochStormTest<T>::EpochStormTest::execute(GlobalTestConfig* gtc, LocalTestConfig* ltc){
+	int ops = 0;
+	int64_t advances = 0;
+	uint64_t r = ltc->seed;
+	std::mt19937_64 gen_k(r);
+	std::mt19937_64 gen_p(r+1);
+	int tid = ltc->tid;
+	LatencySampler sampler(tid<storms? 0 : latency,STORM_OPS.size());
+
+	if(tid<storms){
+		while(!gtc->stop.load(std::memory_order_relaxed)){
+			rm->advance_epoch(tid);
+			advances++;
+		}
+	}
+	else{
+		while(!gtc->stop.load(std::memory_order_relaxed)){
+			r = gen_k()%range;
+			T k = this->fromInt(r);
+			int p = gen_p()%100;
+
+			int op;
+			bool timed = sampler.sample();
+			uint64_t start = timed? LatencySampler::now() : 0;
+
+			if(p>=p_updates){
+				m->get(k,tid);
+				op = 0;
+			}
+			else if(p%2==0){
+				m->put(k,k,tid);
+				op = 1;
+			}
+			else{
+				m->remove(k,tid);
+				op = 2;
+			}
+
+			if(timed){
+				sampler.record(op,start);
+			}
+			ops++;
+		}
+	}
+
+	gtc->recorder->reportThreadInfo("epoch_advances", advances, tid);
+	gtc->recorder->reportThreadInfo("slow_paths", (int64_t)rm->slow_paths(tid), tid);
+	gtc->recorder->reportThreadInfo("helps", (int64_t)rm->helps(tid), tid);
+	sampler.report(gtc,STORM_OPS,tid);
 	return ops;
 }
 
+template <class T>
+void EpochStormTest<T>::cleanup(GlobalTestConfig* gtc){
+	uint64_t slow = 0;
+	for(int i = 0; i<gtc->task_num; i++){
+		slow += rm->slow_paths(i);
+	}
+	gtc->recorder->reportGlobalInfo("slow_paths_per_sec",(long)(slow/gtc->interval));
+}
+
+/*
+ * Enqueue timestamps carried in queue items, in TSC ticks since the
+ * start of the test. An int keeps 31 bits of ticks/16, so an item's
+ * age wraps after window() = 2^35 ticks (about 10 s at 3 GHz); a
+ * string keeps all 64 bits in decimal. Prefilled items carry no stamp.
+ */
+template <class T> class QueueStamp{
+public:
+	static const int SHIFT = 4;
+	static const uint64_t MASK = 0x7fffffff;
+	static T none(){return (T)-1;}
+	static uint64_t window(){return (MASK+1)<<SHIFT;}
+	static T make(uint64_t ticks){return (T)((ticks>>SHIFT)&MASK);}
+	// returns : false for an unstamped item, else true with its age
+	// at ticks in age
+	static bool age(const T& item, uint64_t ticks, uint64_t* age){
+		if(item<0){
+			return false;
+		}
+		*age = (((ticks>>SHIFT)-(uint64_t)item)&MASK)<<SHIFT;
+		return true;
+	}
+};
+
+template <> class QueueStamp<std::string>{
+public:
+	static std::string none(){return "";}
+	static uint64_t window(){return UINT64_MAX;}
+	static std::string make(uint64_t ticks){return std::to_string(ticks);}
+	static bool age(const std::string& item, uint64_t ticks, uint64_t* age){
+		if(item.empty()){
+			return false;
+		}
+		*age = ticks-strtoull(item.c_str(),NULL,10);
+		return true;
+	}
+};
+
+// latency types of the queue tests
+static const std::vector<std::string> QUEUE_OPS = {"sojourn"};
+
+/*
+ * Producer/consumer tests for the queues, which enqueue with insert()
+ * and dequeue with remove(). Every item is stamped when enqueued, and
+ * its sojourn time, from enqueue to dequeue, is recorded for every
+ * dequeued item (or every -d latency=<n>-th) as sojourn_p50 ... _max.
+ * Those columns are NA when the run is long enough for an item's age
+ * to outgrow the stamp's window, where it would wrap undetected.
+ *
+ *	PAIRS		each thread alternates an enqueue and a dequeue
+ *	RANDOM		each op is an enqueue or a dequeue, 50/50
+ *	PRODCON		-d producers=<n> threads (default half) only
+ *			enqueue, the others only dequeue
+ *
+ * -d prefill=<n> enqueues n unstamped items before the run. execute()
+ * returns enqueues plus successful dequeues; dequeues that find the
+ * queue empty are reported separately.
+ */
+template <class T>
+class QueueTest : public Test{
+public:
+	enum Mode {PAIRS, RANDOM, PRODCON};
+
+	RUnorderedMap<T,T>* q;
+	RetiredMonitorable* rm;
+	Mode mode;
+	int prefill;
+	int producers;
+	int latency;
+	uint64_t base;
+	TimeSeries series;
+
+	QueueTest(Mode mode, int prefill):mode(mode),prefill(prefill){}
+	void init(GlobalTestConfig* gtc);
+	void parInit(GlobalTestConfig* gtc, LocalTestConfig* ltc);
+	int execute(GlobalTestConfig* gtc, LocalTestConfig* ltc);
+	void cleanup(GlobalTestConfig* gtc){}
+};
+
+template <class T>
+void QueueTest<T>::init(GlobalTestConfig* gtc){
+	this->q = allocRideableAs<RUnorderedMap<T,T>>(gtc,"QueueTest","RUnorderedMap<T,T>",true);
+	this->rm = dynamic_cast<RetiredMonitorable*>(q);
+	series.init(gtc,q);
+
+	// overrides for constructor arguments
+	if(gtc->checkEnv("prefill")){
+		prefill = atoi((gtc->getEnv("prefill")).c_str());
+	}
+	producers = gtc->checkEnv("producers")? atoi((gtc->getEnv("producers")).c_str()) : gtc->task_num/2;
+	if(mode==PRODCON && (producers<1 || producers>=gtc->task_num)){
+		errexit("QueueTest needs at least one producer and one consumer.");
+	}
+	latency = gtc->checkEnv("latency")? atoi((gtc->getEnv("latency")).c_str()) : 1;
+	// an item is at most the run old, plus a second for stragglers
+	if((gtc->interval+1)*1e9*tscPerNs()>=QueueStamp<T>::window()){
+		fprintf(stderr,"QueueTest: run outlasts the enqueue stamps, sojourn times not recorded.\n");
+		latency = 0;
+	}
+	if(gtc->verbose && mode==PRODCON){
+		printf("Producers:%d Consumers:%d\n",producers,gtc->task_num-producers);
+	}
+
+	// add fields in records:
+	gtc->recorder->addThreadField("enqueues", &Recorder::sumInt64s);
+	gtc->recorder->addThreadField("dequeues", &Recorder::sumInt64s);
+	gtc->recorder->addThreadField("empty_dequeues", &Recorder::sumInt64s);
+	gtc->recorder->addThreadField("obj_retired", &Recorder::sumInt64s);
+	if(latency>0){
+		LatencySampler::addFields(gtc,QUEUE_OPS);
+	}
+	else{
+		LatencySampler::addUnavailable(gtc,QUEUE_OPS);
+	}
+	base = readTSC();
+}
+
+template <class T>
+void QueueTest<T>::parInit(GlobalTestConfig* gtc, LocalTestConfig* ltc){
+	int tid = ltc->tid;
+	T none = QueueStamp<T>::none();
+	for(int i = prefill*tid/gtc->task_num; i<prefill*(tid+1)/gtc->task_num; i++){
+		q->insert(none,none,tid);
+	}
+}
+
+template <class T>
+int QueueTest<T>::QueueTest::execute(GlobalTestConfig* gtc, LocalTestConfig* ltc){
+	int ops = 0;
+	int64_t enqueues = 0;
+	int64_t dequeues = 0;
+	int64_t empties = 0;
+	int tid = ltc->tid;
+	std::mt19937_64 gen_p(ltc->seed);
+	LatencySampler sampler(latency,QUEUE_OPS.size());
+	series.start(tid);
+	bool enqueue = false;
+
+	while(!gtc->stop.load(std::memory_order_relaxed)){
+		switch(mode){
+		case PAIRS:
+			enqueue = !enqueue;
+			break;
+		case RANDOM:
+			enqueue = gen_p()%2==0;
+			break;
+		case PRODCON:
+			enqueue = tid<producers;
+			break;
+		}
+
+		if(enqueue){
+			T item = QueueStamp<T>::make(readTSC()-base);
+			q->insert(item,item,tid);
+			enqueues++;
+			ops++;
+		}
+		else{
+			optional<T> item = q->remove(QueueStamp<T>::none(),tid);
+			if(!item.has_value()){
+				empties++;
+				continue;
+			}
+			uint64_t age;
+			if(sampler.sample() && QueueStamp<T>::age(item.value(),readTSC()-base,&age)){
+				sampler.recordTicks(0,age);
+			}
+			dequeues++;
+			ops++;
+		}
+		series.progress(tid,ops);
+	}
+
+	gtc->recorder->reportThreadInfo("enqueues", enqueues, tid);
+	gtc->recorder->reportThreadInfo("dequeues", dequeues, tid);
+	gtc->recorder->reportThreadInfo("empty_dequeues", empties, tid);
+	gtc->recorder->reportThreadInfo("obj_retired", rm->report_retired(tid), tid);
+	sampler.report(gtc,QUEUE_OPS,tid);
+	series.finish(tid);
+	return ops;
+}
+
+// object retired by TrackerBenchTest, sized like a small list node
+class TrackerBenchNode{
+public:
+	uint64_t payload[3];
+	inline bool deletable(){return true;}
+};
+
+/*
+ * Tracker-only micro-benchmarks: drives a MemoryTracker of the type
+ * given by -d tracker directly, with synthetic nodes and pointer
+ * cells and no data structure. Each thread times batches of BATCH
+ * calls with the TSC, leaving the setup of every batch untimed, and
+ * reports the mean cost per call in ns:
+ *
+ *	READ		read_ns: read() of a cell whose reservation is
+ *			current, cycling through the slots in one op
+ *	STALE_READ	stale_read_ns: read() right after the epoch has
+ *			advanced, once per slot; with -d attempts=1 WFE
+ *			takes its slow path on each (slow_paths column)
+ *	RETIRE		retire_ns: retire() of fresh nodes, including the
+ *			tracker's own periodic empty()
+ *	SCAN		empty_ns: empty() with BATCH nodes retired since
+ *			the last call (collection otherwise off), per node;
+ *			scales with -t and -d slots
+ *	ALLOC		alloc_ns and reclaim_ns: alloc() and thread-local
+ *			reclaim() of a node
+ *
+ * -d slots=<n> (default 3) and -d cells=<n> (default 1024) size the
+ * reservations and the shared cell array; -d epochf and -d emptyf are
+ * read as by the rideables.
+ */
+class TrackerBenchTest : public Test{
+public:
+	enum Mode {READ, STALE_READ, RETIRE, SCAN, ALLOC};
+	static const int BATCH = 64;
+
+	Mode mode;
+	int slots;
+	int cells_num;
+	MemoryTracker<TrackerBenchNode>* tracker;
+	std::atomic<TrackerBenchNode*>* cells;
+
+	TrackerBenchTest(Mode mode):mode(mode){}
+	void init(GlobalTestConfig* gtc);
+	int execute(GlobalTestConfig* gtc, LocalTestConfig* ltc);
+	void cleanup(GlobalTestConfig* gtc){}
+
+	// Recorder summary function: each thread reports "ticks:calls";
+	// returns the mean ns per call over all threads
+	static std::string meanNs(std::list<std::string> list);
+
+private:
+	TrackerBenchNode* mkNode(int tid);
+	void report(GlobalTestConfig* gtc, const char* field, uint64_t ticks, uint64_t calls, int tid);
+};
 
 // by Hs: test framework used for debugging, modifiy it as needed.
 class DebugTest : public Test{
@@ -372,9 +1348,6 @@ inline int MapVerifyTest<std::string>::toInt(std::string v){
 
 template <class T>
 int MapVerifyTest<T>::execute(GlobalTestConfig* gtc, LocalTestConfig* ltc){
-	struct timeval time_up = gtc->finish;
-	struct timeval now;
-	gettimeofday(&now,NULL);
 	int ops = 0;
 	uint64_t r = ltc->seed;
 	std::mt19937_64 gen_k(r);
@@ -390,8 +1363,7 @@ int MapVerifyTest<T>::execute(GlobalTestConfig* gtc, LocalTestConfig* ltc){
 	uint32_t insKey = ug->initial(tid);
 	uint32_t remKey = ug->initial((tid+1)%(gtc->task_num));
 
-	while(now.tv_sec < time_up.tv_sec 
-		|| (now.tv_sec==time_up.tv_sec && now.tv_usec<time_up.tv_usec) ){
+	while(!gtc->stop.load(std::memory_order_relaxed)){
 		// r = nextRand(r);
 		r = gen_k();
 		if(gen_p()%2==0){
@@ -418,8 +1390,6 @@ int MapVerifyTest<T>::execute(GlobalTestConfig* gtc, LocalTestConfig* ltc){
 			remKey = ug->next(remKey,tid);
 		}
 		ops++;
-
-		gettimeofday(&now,NULL);
 	}
 	return ops;
 }
@@ -481,9 +1451,6 @@ inline uint32_t QueryVerifyTest<std::string>::toInt(std::string v){
 
 template <class T>
 int QueryVerifyTest<T>::execute(GlobalTestConfig* gtc, LocalTestConfig* ltc){
-	struct timeval time_up = gtc->finish;
-	struct timeval now;
-	gettimeofday(&now,NULL);
 	int ops = 0;
 	uint64_t r = ltc->seed;
 	std::mt19937_64 gen(r);
@@ -503,8 +1470,7 @@ int QueryVerifyTest<T>::execute(GlobalTestConfig* gtc, LocalTestConfig* ltc){
 		if(curKey<leftKey) leftKey=curKey;
 		if(curKey>rightKey) rightKey=curKey;
 	}
-	while(now.tv_sec < time_up.tv_sec 
-		|| (now.tv_sec==time_up.tv_sec && now.tv_usec<time_up.tv_usec) ){
+	while(!gtc->stop.load(std::memory_order_relaxed)){
 		// r = nextRand(r);
 		r = gen();
 		if(r%2==0){
@@ -546,7 +1512,6 @@ int QueryVerifyTest<T>::execute(GlobalTestConfig* gtc, LocalTestConfig* ltc){
 			}
 		}
 		ops++;
-		gettimeofday(&now,NULL);
 	}
 	return ops;
 }
@@ -0,0 +1,187 @@
+/*
+
+Copyright 2017 University of Rochester
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*/
+
+
+#ifndef KEYDISTRIBUTION_HPP
+#define KEYDISTRIBUTION_HPP
+
+#include <algorithm>
+#include <string>
+#include <random>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include "Harness.hpp"
+
+/*
+ * Key distributions for the map tests, selected with -d dist=<spec>
+ * and modelled on YCSB's request distributions:
+ *
+ *	uniform			every key in [0,range) equally likely (default)
+ *	zipf[:theta]		scrambled Zipfian, theta defaults to 0.99; the
+ *				popular keys are spread over the key space by
+ *				hashing the Zipfian rank, as YCSB does
+ *	hotspot[:data:ops]	a fraction ops of the draws (default 0.8) go
+ *				to the first fraction data of the keys
+ *				(default 0.2), the rest to the others
+ *	sequential		each thread walks the keys in order from its
+ *				own offset, wrapping at range
+ *	latest[:theta]		Zipfian distance back from the newest key,
+ *				where the newest key advances by one per draw
+ *
+ * The object is shared and read-only; the per-thread state of sequential
+ * and latest is the counter passed to next().
+ */
+class KeyDistribution{
+public:
+	enum Kind {UNIFORM, ZIPF, HOTSPOT, SEQUENTIAL, LATEST};
+
+private:
+	Kind kind = UNIFORM;
+	uint64_t range = 1;
+	// Zipfian constants, from Gray et al., "Quickly Generating
+	// Billion-Record Synthetic Databases", as in YCSB
+	double theta = 0.99;
+	double zetan, alpha, eta;
+	// hotspot fractions
+	double hot_data = 0.2;
+	double hot_ops = 0.8;
+
+	static double zeta(uint64_t n, double theta){
+		double sum = 0;
+		for(uint64_t i = 1; i<=n; i++){
+			sum += 1.0/pow((double)i,theta);
+		}
+		return sum;
+	}
+	static inline double uniform01(std::mt19937_64& gen){
+		return (gen()>>11)*(1.0/9007199254740992.0);
+	}
+	// FNV-1a of the 8 bytes of v, YCSB's scrambling hash
+	static inline uint64_t fnv64(uint64_t v){
+		uint64_t h = 0xcbf29ce484222325ull;
+		for(int i = 0; i<8; i++){
+			h ^= v&0xff;
+			h *= 0x100000001b3ull;
+			v >>= 8;
+		}
+		return h;
+	}
+	inline uint64_t zipf(std::mt19937_64& gen) const{
+		double u = uniform01(gen);
+		double uz = u*zetan;
+		if(uz<1.0){
+			return 0;
+		}
+		if(uz<1.0+pow(0.5,theta)){
+			return 1;
+		}
+		uint64_t r = (uint64_t)(range*pow(eta*u-eta+1.0,alpha));
+		return r<range? r : range-1;
+	}
+	static double parseFraction(const std::string& s, const char* what){
+		char* end;
+		double v = strtod(s.c_str(),&end);
+		if(s.empty() || *end!='\0' || !(v>0.0 && v<1.0)){
+			errexit(what);
+		}
+		return v;
+	}
+
+public:
+	KeyDistribution(){}
+	KeyDistribution(const std::string& spec, uint64_t range):range(range==0? 1 : range){
+		std::string name = spec.substr(0,spec.find(':'));
+		std::string args = spec.find(':')==std::string::npos? "" : spec.substr(spec.find(':')+1);
+		if(name=="" || name=="uniform"){
+			kind = UNIFORM;
+		}
+		else if(name=="zipf" || name=="latest"){
+			kind = name=="zipf"? ZIPF : LATEST;
+			if(args!=""){
+				theta = parseFraction(args,"dist: theta must be in (0,1).");
+			}
+		}
+		else if(name=="hotspot"){
+			kind = HOTSPOT;
+			if(args!=""){
+				size_t colon = args.find(':');
+				if(colon==std::string::npos){
+					errexit("dist: hotspot takes <data fraction>:<op fraction>.");
+				}
+				hot_data = parseFraction(args.substr(0,colon),"dist: hotspot fractions must be in (0,1).");
+				hot_ops = parseFraction(args.substr(colon+1),"dist: hotspot fractions must be in (0,1).");
+			}
+		}
+		else if(name=="sequential"){
+			kind = SEQUENTIAL;
+		}
+		else{
+			errexit("dist: unknown distribution.");
+		}
+		if(kind==ZIPF || kind==LATEST){
+			zetan = zeta(this->range,theta);
+			alpha = 1.0/(1.0-theta);
+			eta = (1.0-pow(2.0/this->range,1.0-theta))/(1.0-zeta(2,theta)/zetan);
+		}
+	}
+
+	std::string describe() const{
+		switch(kind){
+		case ZIPF: return "zipf:"+std::to_string(theta);
+		case HOTSPOT: return "hotspot:"+std::to_string(hot_data)+":"+std::to_string(hot_ops);
+		case SEQUENTIAL: return "sequential";
+		case LATEST: return "latest:"+std::to_string(theta);
+		default: return "uniform";
+		}
+	}
+
+	// initial counter for thread tid of nthreads
+	uint64_t start(int tid, int nthreads) const{
+		return range*tid/nthreads;
+	}
+
+	// returns : the next key in [0,range)
+	inline uint64_t next(std::mt19937_64& gen, uint64_t& counter) const{
+		switch(kind){
+		case ZIPF:
+			return fnv64(zipf(gen))%range;
+		case HOTSPOT:{
+			uint64_t hot = std::max<uint64_t>(1,(uint64_t)(range*hot_data));
+			if(hot>=range || uniform01(gen)<hot_ops){
+				return gen()%hot;
+			}
+			return hot+gen()%(range-hot);
+		}
+		case SEQUENTIAL:{
+			uint64_t k = counter;
+			counter = (k+1==range)? 0 : k+1;
+			return k;
+		}
+		case LATEST:{
+			uint64_t newest = counter;
+			counter = (newest+1==range)? 0 : newest+1;
+			return (newest+range-zipf(gen))%range;
+		}
+		default:
+			return gen()%range;
+		}
+	}
+};
+
+#endif
@@ -0,0 +1,223 @@
+/*
+
+Copyright 2017 University of Rochester
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*/
+
+
+#ifndef LATENCYHISTOGRAM_HPP
+#define LATENCYHISTOGRAM_HPP
+
+#include <algorithm>
+#include <list>
+#include <string>
+#include <vector>
+#include <sstream>
+#include <cstdint>
+#include "Harness.hpp"
+
+/*
+ * Log-linear histogram of latencies in nanoseconds, in the manner of
+ * HdrHistogram: values below 2^SUB_BITS get a bucket each, and every
+ * further power of two is split into 2^(SUB_BITS-1) buckets, so a
+ * recorded value is known to within about 3%. The maximum is kept
+ * exactly.
+ */
+class LatencyHistogram{
+public:
+	static const int SUB_BITS = 6;
+	static const int SUB_COUNT = 1<<SUB_BITS;
+	static const int HALF_COUNT = SUB_COUNT/2;
+	static const int BUCKETS = SUB_COUNT+(64-SUB_BITS)*HALF_COUNT;
+
+private:
+	std::vector<uint64_t> counts;
+	uint64_t total;
+	uint64_t max;
+
+	static int indexOf(uint64_t v){
+		if(v<(uint64_t)SUB_COUNT){
+			return v;
+		}
+		int exp = 63-__builtin_clzll(v)-(SUB_BITS-1);
+		return SUB_COUNT+(exp-1)*HALF_COUNT+(int)((v>>exp)-HALF_COUNT);
+	}
+	// largest value that falls into bucket idx
+	static uint64_t highestOf(int idx){
+		if(idx<SUB_COUNT){
+			return idx;
+		}
+		int exp = (idx-SUB_COUNT)/HALF_COUNT+1;
+		uint64_t sub = (idx-SUB_COUNT)%HALF_COUNT+HALF_COUNT;
+		return ((sub+1)<<exp)-1;
+	}
+
+public:
+	LatencyHistogram():counts(BUCKETS,0),total(0),max(0){}
+
+	inline void record(uint64_t ns){
+		counts[indexOf(ns)]++;
+		total++;
+		if(ns>max){
+			max = ns;
+		}
+	}
+
+	void merge(const LatencyHistogram& other){
+		for(int i = 0; i<BUCKETS; i++){
+			counts[i] += other.counts[i];
+		}
+		total += other.total;
+		if(other.max>max){
+			max = other.max;
+		}
+	}
+
+	// returns : the smallest recorded value v (up to bucket precision)
+	// such that a fraction q of the recorded values are at most v,
+	// or 0 if nothing was recorded
+	uint64_t quantile(double q){
+		if(total==0){
+			return 0;
+		}
+		uint64_t rank = (uint64_t)(q*total+0.5);
+		if(rank<1){
+			rank = 1;
+		}
+		uint64_t seen = 0;
+		for(int i = 0; i<BUCKETS; i++){
+			seen += counts[i];
+			if(seen>=rank){
+				return std::min(highestOf(i),max);
+			}
+		}
+		return max;
+	}
+
+	// "max idx:count idx:count ..." with only the non-empty buckets
+	std::string serialize(){
+		std::string s = std::to_string(max);
+		for(int i = 0; i<BUCKETS; i++){
+			if(counts[i]!=0){
+				s += " "+std::to_string(i)+":"+std::to_string(counts[i]);
+			}
+		}
+		return s;
+	}
+	void deserialize(const std::string& s){
+		std::istringstream in(s);
+		uint64_t m = 0;
+		in>>m;
+		if(m>max){
+			max = m;
+		}
+		int idx;
+		char colon;
+		uint64_t c;
+		while(in>>idx>>colon>>c){
+			if(idx>=0 && idx<BUCKETS){
+				counts[idx] += c;
+				total += c;
+			}
+		}
+	}
+
+	// Recorder summary function: merges the histograms serialized by
+	// every thread and returns their PERMYRIAD/10000 quantile.
+	template <int PERMYRIAD>
+	static std::string summarize(std::list<std::string> list){
+		LatencyHistogram h;
+		for(std::string s : list){
+			h.deserialize(s);
+		}
+		return std::to_string(h.quantile(PERMYRIAD/10000.0));
+	}
+};
+
+/*
+ * Per-thread latency sampling for a test's operation types. Every
+ * every-th operation is timed with the TSC, so the timing cost can be
+ * traded for resolution with -d latency=<every>. Each type gets
+ * <op>_p50, _p90, _p99, _p99.9 and _max columns, in nanoseconds.
+ */
+class LatencySampler{
+	int every;
+	int countdown;
+	double tsc_per_ns;
+	std::vector<LatencyHistogram> hists;
+
+	static const char* const* suffixes(){
+		static const char* const s[] = {"_p50","_p90","_p99","_p99.9","_max"};
+		return s;
+	}
+
+public:
+	LatencySampler(int every, int n_ops):every(every),countdown(every),tsc_per_ns(tscPerNs()),hists(n_ops){}
+
+	static inline uint64_t now(){
+		return readTSC();
+	}
+
+	static void addFields(GlobalTestConfig* gtc, const std::vector<std::string>& ops){
+		const char* const* sfx = suffixes();
+		for(const std::string& op : ops){
+			gtc->recorder->addThreadField(op+sfx[0], &LatencyHistogram::summarize<5000>);
+			gtc->recorder->addThreadField(op+sfx[1], &LatencyHistogram::summarize<9000>);
+			gtc->recorder->addThreadField(op+sfx[2], &LatencyHistogram::summarize<9900>);
+			gtc->recorder->addThreadField(op+sfx[3], &LatencyHistogram::summarize<9990>);
+			gtc->recorder->addThreadField(op+sfx[4], &LatencyHistogram::summarize<10000>);
+		}
+	}
+	// reports NA in the columns of ops that cannot be measured
+	static void addUnavailable(GlobalTestConfig* gtc, const std::vector<std::string>& ops){
+		const char* const* sfx = suffixes();
+		for(const std::string& op : ops){
+			for(int j = 0; j<5; j++){
+				gtc->recorder->reportGlobalInfo(op+sfx[j],std::string("NA"));
+			}
+		}
+	}
+
+	// returns : whether the next operation should be timed
+	inline bool sample(){
+		if(every<=0 || --countdown>0){
+			return false;
+		}
+		countdown = every;
+		return true;
+	}
+	inline void record(int op, uint64_t start){
+		recordTicks(op,now()-start);
+	}
+	// records a latency already measured in TSC ticks
+	inline void recordTicks(int op, uint64_t ticks){
+		hists[op].record((uint64_t)(ticks/tsc_per_ns));
+	}
+
+	void report(GlobalTestConfig* gtc, const std::vector<std::string>& ops, int tid){
+		if(every<=0){
+			return;
+		}
+		const char* const* sfx = suffixes();
+		for(size_t i = 0; i<ops.size(); i++){
+			std::string s = hists[i].serialize();
+			for(int j = 0; j<5; j++){
+				gtc->recorder->reportThreadInfo(ops[i]+sfx[j], s, tid);
+			}
+		}
+	}
+};
+
+#endif
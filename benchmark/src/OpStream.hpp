@@ -0,0 +1,64 @@
+/*
+
+Copyright 2017 University of Rochester
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*/
+
+
+#ifndef OPSTREAM_HPP
+#define OPSTREAM_HPP
+
+#include <vector>
+#include <random>
+#include <cstdint>
+#include "KeyDistribution.hpp"
+
+/*
+ * One thread's operations for a map test, generated before the timed
+ * phase: the keys, already converted to T, and the 0-99 roll that
+ * picks each operation type. The draws are the ones the live loop
+ * would make from the same seed and distribution counter. next()
+ * replays them, wrapping around at the end, so the measured loop
+ * neither runs the RNG nor builds keys.
+ */
+template <class T>
+class OpStream{
+	std::vector<T> keys;
+	std::vector<uint8_t> rolls;
+	size_t pos = 0;
+
+public:
+	template <class FromInt>
+	OpStream(size_t n, uint64_t seed, const KeyDistribution& dist, uint64_t counter, FromInt fromInt){
+		std::mt19937_64 gen_k(seed);
+		std::mt19937_64 gen_p(seed+1);
+		keys.reserve(n);
+		rolls.reserve(n);
+		for(size_t i = 0; i<n; i++){
+			keys.push_back(fromInt(dist.next(gen_k,counter)));
+			rolls.push_back(gen_p()%100);
+		}
+	}
+
+	// returns : the key of the next operation, and its roll in p
+	inline const T& next(int& p){
+		size_t i = pos;
+		pos = (i+1==keys.size())? 0 : i+1;
+		p = rolls[i];
+		return keys[i];
+	}
+};
+
+#endif
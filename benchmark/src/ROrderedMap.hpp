@@ -26,6 +26,24 @@ limitations under the License.
 #include <map>
 
 
+// Receives the pairs of a range scan, in key order. The references
+// are only valid during the call, while the scanning thread still
+// holds its reservations on the node they point into.
+template <class K, class V> class RangeVisitor{
+public:
+	virtual ~RangeVisitor(){}
+	virtual void visit(const K& key, const V& val) = 0;
+};
+
+// Copies the pairs it visits into a map, to build rangeQuery on rangeScan.
+template <class K, class V> class RangeCollector : public RangeVisitor<K, V>{
+public:
+	std::map<K, V> res;
+	void visit(const K& key, const V& val){
+		res.emplace(key, val);
+	}
+};
+
 template <class K, class V> class ROrderedMap : public virtual RUnorderedMap<K, V>{
 //class ROrderedMap : public virtual RUnorderedMap<std::string,std::string>{
 public:
@@ -56,6 +74,19 @@ public:
 	// Get all the values between key1 and key2, inclusively. (Tentative)
 	// returns: the pointer to the first pointer of an array
 	virtual std::map<K, V> rangeQuery(K key1, K key2, int& len, int tid) = 0;
+
+	// Hands all the pairs between key1 and key2, inclusively, to visitor
+	// without copying them out of the map.
+	// returns: the number of pairs visited
+	// The default one scans the result of rangeQuery.
+	virtual int rangeScan(K key1, K key2, RangeVisitor<K, V>* visitor, int tid){
+		int len = 0;
+		std::map<K, V> res = rangeQuery(key1, key2, len, tid);
+		for(auto& kv : res){
+			visitor->visit(kv.first, kv.second);
+		}
+		return res.size();
+	}
 	
 };
 
@@ -21,6 +21,8 @@ limitations under the License.
 #define RUNORDEREDMAP_HPP
 
 #include <string>
+#include <thread>
+#include <vector>
 #include "Rideable.hpp"
 
 #include "optional.hpp"
@@ -32,6 +34,16 @@ public:
 	// returns : the most recent value set for that key
 	virtual optional<V> get(K key, int tid)=0;
 
+	// Gets the values of n keys in one call; results[i] receives
+	// what get(keys[i]) would return. Implementations may overlap
+	// the lookups, which are then not ordered with respect to each other.
+	// By default the keys are looked up one by one.
+	virtual void multiGet(const K* keys, optional<V>* results, size_t n, int tid){
+		for(size_t i=0;i<n;i++){
+			results[i]=get(keys[i],tid);
+		}
+	}
+
 	// Puts a new key/value pair into the map	
 	// returns : the previous value for this key,
 	// or NULL if no such value exists
@@ -50,6 +62,24 @@ public:
 	// if the key is already present in the map
 	// returns : the replaced value, or NULL if replace was unsuccessful
 	virtual optional<V> replace(K key, V val, int tid)=0;
+
+	// Loads n pairs with distinct keys, sorted by key, into an empty map.
+	// Must not overlap with other operations. The work is spread over
+	// nthreads threads, which use tids 0 to nthreads-1.
+	// By default each thread inserts one slice of the pairs.
+	virtual void bulkLoad(const K* keys, const V* vals, size_t n, int nthreads){
+		std::vector<std::thread> threads;
+		for(int t=0;t<nthreads;t++){
+			threads.emplace_back([=]{
+				for(size_t i=n*t/nthreads;i<n*(t+1)/nthreads;i++){
+					insert(keys[i],vals[i],t);
+				}
+			});
+		}
+		for(auto& th : threads){
+			th.join();
+		}
+	}
 };
 
 #endif
@@ -20,16 +20,19 @@ limitations under the License.
 #ifndef RETIREDMONITORABLE_HPP
 #define RETIREDMONITORABLE_HPP
 
+#include <algorithm>
 #include <queue>
 #include <list>
 #include <vector>
 #include <atomic>
 #include "ConcurrentPrimitives.hpp"
 #include "RAllocator.hpp"
+#include "MemoryTracker.hpp"
 
 class RetiredMonitorable{
 private:
 	padded<uint64_t>* retired_cnt;
+	std::vector<TrackerStats*> trackers;
 public:
 	RetiredMonitorable(GlobalTestConfig* gtc){
 		retired_cnt = new padded<uint64_t>[gtc->task_num];
@@ -40,6 +43,64 @@ public:
 	uint64_t report_retired(int tid){
 		return retired_cnt[tid].ui;
 	}
+
+	// registers a tracker with the time-series sampler
+	void monitor(TrackerStats* t){
+		trackers.push_back(t);
+	}
+	uint64_t unreclaimed(){
+		uint64_t sum = 0;
+		for(TrackerStats* t : trackers){
+			sum += t->unreclaimed();
+		}
+		return sum;
+	}
+	// retired bytes not yet freed: the trackers', plus pinned_bytes()
+	uint64_t unreclaimed_bytes(){
+		uint64_t sum = pinned_bytes();
+		for(TrackerStats* t : trackers){
+			sum += t->unreclaimed_bytes();
+		}
+		return sum;
+	}
+	// bytes the rideable cannot free yet but no tracker holds, such as
+	// replaced nodes in a BonsaiTree arena that is still in use
+	virtual uint64_t pinned_bytes(){
+		return 0;
+	}
+	uint64_t epoch(){
+		uint64_t e = 0;
+		for(TrackerStats* t : trackers){
+			e = std::max(e,t->epoch());
+		}
+		return e;
+	}
+	uint64_t slow_paths(int tid){
+		uint64_t sum = 0;
+		for(TrackerStats* t : trackers){
+			sum += t->slow_paths(tid);
+		}
+		return sum;
+	}
+	uint64_t helps(int tid){
+		uint64_t sum = 0;
+		for(TrackerStats* t : trackers){
+			sum += t->helps(tid);
+		}
+		return sum;
+	}
+	uint64_t reads(int tid){
+		uint64_t sum = 0;
+		for(TrackerStats* t : trackers){
+			sum += t->reads(tid);
+		}
+		return sum;
+	}
+	void advance_epoch(int tid){
+		for(TrackerStats* t : trackers){
+			t->advance_epoch(tid);
+		}
+	}
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,284 @@
+/*
+
+Copyright 2017 University of Rochester
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*/
+
+
+#ifndef SNAPSHOT_HPP
+#define SNAPSHOT_HPP
+
+#include <algorithm>
+#include <string>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <cstring>
+#include <cstdint>
+#include <cstdio>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "Harness.hpp"
+#include "RUnorderedMap.hpp"
+
+/*
+ * On-disk image of a map's key/value set, used to restart a prefilled
+ * experiment without redoing its updates. All fields are in native
+ * byte order:
+ *
+ *	header:	char magic[8]; uint32_t key_size, val_size;
+ *		uint64_t count, blocks, range, prefill;
+ *	block:	uint64_t bytes, count; then count records of
+ *		uint32_t key_len, key bytes, uint32_t val_len, val bytes.
+ *
+ * key_size and val_size are sizeof the type, or 0 for std::string.
+ * range and prefill are those of the test that wrote the file, which
+ * must match on load.
+ * Records are sorted by distinct keys over the whole file, which the
+ * loader checks, and a block holds at most BLOCK_RECORDS of them, so
+ * that the loader can find every block from the headers alone and
+ * decode them in parallel.
+ */
+
+// how a key or value type is laid out in a record; plain types are copied
+template <class T> class SnapshotCodec{
+public:
+	static const uint32_t tag = sizeof(T);
+	static bool fits(uint32_t len){return len==sizeof(T);}
+	static uint32_t size(const T& v){return sizeof(T);}
+	static const char* data(const T& v){return (const char*)&v;}
+	static T decode(const char* p, uint32_t len){
+		T v;
+		memcpy(&v,p,sizeof(T));
+		return v;
+	}
+};
+
+template <> class SnapshotCodec<std::string>{
+public:
+	static const uint32_t tag = 0;
+	static bool fits(uint32_t len){return true;}
+	static uint32_t size(const std::string& v){return v.size();}
+	static const char* data(const std::string& v){return v.data();}
+	static std::string decode(const char* p, uint32_t len){
+		return std::string(p,len);
+	}
+};
+
+template <class K, class V> class Snapshot{
+	struct Header{
+		char magic[8];
+		uint32_t key_size;
+		uint32_t val_size;
+		uint64_t count;
+		uint64_t blocks;
+		uint64_t range;
+		uint64_t prefill;
+	};
+	struct BlockHeader{
+		uint64_t bytes;
+		uint64_t count;
+	};
+
+	static void put(FILE* f, const void* p, size_t len){
+		if(fwrite(p,1,len,f)!=len){
+			errexit("Snapshot: write failed.");
+		}
+	}
+	static void header(Header* h){
+		memcpy(h->magic,"RIDESNP2",8);
+		h->key_size = SnapshotCodec<K>::tag;
+		h->val_size = SnapshotCodec<V>::tag;
+	}
+
+public:
+	static const size_t BLOCK_RECORDS = 4096;
+
+	static bool exists(const std::string& path){
+		return access(path.c_str(),R_OK)==0;
+	}
+
+	// keys must be sorted and distinct
+	static void write(const std::string& path, const K* keys, const V* vals, size_t n,
+	 uint64_t range, uint64_t prefill){
+		FILE* f = fopen(path.c_str(),"wb");
+		if(f==NULL){
+			errexit("Snapshot: cannot create file.");
+		}
+		Header h;
+		header(&h);
+		h.count = n;
+		h.blocks = (n+BLOCK_RECORDS-1)/BLOCK_RECORDS;
+		h.range = range;
+		h.prefill = prefill;
+		put(f,&h,sizeof(h));
+		for(size_t first = 0; first<n; first+=BLOCK_RECORDS){
+			size_t last = std::min(n,first+BLOCK_RECORDS);
+			BlockHeader b;
+			b.bytes = 0;
+			b.count = last-first;
+			for(size_t i = first; i<last; i++){
+				b.bytes += 2*sizeof(uint32_t)+SnapshotCodec<K>::size(keys[i])
+					+SnapshotCodec<V>::size(vals[i]);
+			}
+			put(f,&b,sizeof(b));
+			for(size_t i = first; i<last; i++){
+				uint32_t len = SnapshotCodec<K>::size(keys[i]);
+				put(f,&len,sizeof(len));
+				put(f,SnapshotCodec<K>::data(keys[i]),len);
+				len = SnapshotCodec<V>::size(vals[i]);
+				put(f,&len,sizeof(len));
+				put(f,SnapshotCodec<V>::data(vals[i]),len);
+			}
+		}
+		if(fclose(f)!=0){
+			errexit("Snapshot: write failed.");
+		}
+	}
+
+	// maps the file, decodes its blocks with nthreads threads and
+	// bulk-loads the pairs into m, which must be empty. The file must
+	// have been written for the same range and prefill.
+	// returns : the number of pairs loaded
+	static size_t load(const std::string& path, RUnorderedMap<K,V>* m, int nthreads,
+	 uint64_t range, uint64_t prefill){
+		int fd = open(path.c_str(),O_RDONLY);
+		struct stat st;
+		if(fd<0 || fstat(fd,&st)!=0){
+			errexit("Snapshot: cannot open file.");
+		}
+		size_t file_size = st.st_size;
+		if(file_size<sizeof(Header)){
+			errexit("Snapshot: truncated file.");
+		}
+		const char* base = (const char*)mmap(NULL,file_size,PROT_READ,MAP_PRIVATE|MAP_POPULATE,fd,0);
+		if(base==MAP_FAILED){
+			errexit("Snapshot: mmap failed.");
+		}
+
+		Header expected;
+		header(&expected);
+		const Header* h = (const Header*)base;
+		if(memcmp(h->magic,expected.magic,8)!=0){
+			errexit("Snapshot: not a snapshot file.");
+		}
+		if(h->key_size!=expected.key_size || h->val_size!=expected.val_size){
+			errexit("Snapshot: key or value type does not match.");
+		}
+		if(h->range!=range || h->prefill!=prefill){
+			errexit("Snapshot: range or prefill does not match.");
+		}
+		if(h->blocks>(file_size-sizeof(Header))/sizeof(BlockHeader)){
+			errexit("Snapshot: corrupted header.");
+		}
+
+		/* locate the blocks and the index of their first record */
+		std::vector<const char*> block_start(h->blocks);
+		std::vector<const char*> block_end(h->blocks);
+		std::vector<size_t> block_first(h->blocks);
+		size_t offset = sizeof(Header);
+		size_t n = 0;
+		for(uint64_t b = 0; b<h->blocks; b++){
+			if(offset+sizeof(BlockHeader)>file_size){
+				errexit("Snapshot: truncated file.");
+			}
+			const BlockHeader* bh = (const BlockHeader*)(base+offset);
+			offset += sizeof(BlockHeader);
+			if(bh->bytes>file_size-offset){
+				errexit("Snapshot: truncated file.");
+			}
+			block_start[b] = base+offset;
+			block_first[b] = n;
+			offset += bh->bytes;
+			block_end[b] = base+offset;
+			n += bh->count;
+		}
+		if(n!=h->count){
+			errexit("Snapshot: corrupted block headers.");
+		}
+
+		/* every record must lie within its block's bytes, and keys must
+		 * be strictly increasing, as bulkLoad() requires */
+		std::vector<K> keys(n);
+		std::vector<V> vals(n);
+		std::atomic<bool> corrupted(false);
+		std::vector<std::thread> threads;
+		for(int t = 0; t<nthreads; t++){
+			threads.emplace_back([&,t]{
+				for(size_t b = h->blocks*t/nthreads; b<h->blocks*(t+1)/nthreads; b++){
+					const char* p = block_start[b];
+					const char* end = block_end[b];
+					size_t last = (b+1<h->blocks)? block_first[b+1] : n;
+					for(size_t i = block_first[b]; i<last; i++){
+						uint32_t len;
+						if((size_t)(end-p)<sizeof(len)){
+							corrupted = true;
+							return;
+						}
+						memcpy(&len,p,sizeof(len));
+						p += sizeof(len);
+						if(len>(size_t)(end-p) || !SnapshotCodec<K>::fits(len)){
+							corrupted = true;
+							return;
+						}
+						keys[i] = SnapshotCodec<K>::decode(p,len);
+						p += len;
+						if(i>block_first[b] && !(keys[i-1]<keys[i])){
+							corrupted = true;
+							return;
+						}
+						if((size_t)(end-p)<sizeof(len)){
+							corrupted = true;
+							return;
+						}
+						memcpy(&len,p,sizeof(len));
+						p += sizeof(len);
+						if(len>(size_t)(end-p) || !SnapshotCodec<V>::fits(len)){
+							corrupted = true;
+							return;
+						}
+						vals[i] = SnapshotCodec<V>::decode(p,len);
+						p += len;
+					}
+					if(p!=end){
+						corrupted = true;
+						return;
+					}
+				}
+			});
+		}
+		for(auto& th : threads){
+			th.join();
+		}
+		for(uint64_t b = 1; b<h->blocks && !corrupted; b++){
+			size_t i = block_first[b];
+			if(i>0 && i<n && !(keys[i-1]<keys[i])){
+				corrupted = true;
+			}
+		}
+		munmap((void*)base,file_size);
+		close(fd);
+		if(corrupted){
+			errexit("Snapshot: corrupted record.");
+		}
+
+		m->bulkLoad(keys.data(),vals.data(),n,nthreads);
+		return n;
+	}
+};
+
+#endif
@@ -0,0 +1,201 @@
+/*
+
+Copyright 2017 University of Rochester
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*/
+
+
+#ifndef TIMESERIES_HPP
+#define TIMESERIES_HPP
+
+#include <algorithm>
+#include <string>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <cstdio>
+#include <cstdint>
+#include <time.h>
+#include <errno.h>
+#include <unistd.h>
+#include "Harness.hpp"
+#include "ConcurrentPrimitives.hpp"
+#include "RetiredMonitorable.hpp"
+
+/*
+ * Samples a run every -d sample=<ms> milliseconds from a separate
+ * thread: operations so far and their rate since the last sample, the
+ * rideable's unreclaimed objects and bytes, the share of those bytes
+ * it pins itself (see RetiredMonitorable::pinned_bytes()), its tracker
+ * epoch, and the process RSS. The rows are kept in memory and appended at the end
+ * of the run to -d series=<file>, by default the -o file with a
+ * _series suffix. Each row carries the run's datetime, rideable and
+ * environment, which identify it in the -o file.
+ *
+ * Tests call start() and finish() at the ends of execute() and
+ * progress() after every operation.
+ */
+class TimeSeries{
+	struct Sample{
+		uint64_t ns;
+		uint64_t ops;
+		uint64_t unreclaimed;
+		uint64_t unreclaimed_bytes;
+		uint64_t pinned_bytes;
+		uint64_t epoch;
+		uint64_t rss;
+	};
+
+	GlobalTestConfig* gtc = NULL;
+	RetiredMonitorable* rm = NULL;
+	int interval_ms = 0;
+	std::string path;
+	paddedAtomic<uint64_t>* ops = NULL;
+	std::vector<Sample> samples;
+	std::thread sampler;
+
+	static uint64_t now(){
+		struct timespec ts;
+		clock_gettime(CLOCK_MONOTONIC,&ts);
+		return (uint64_t)ts.tv_sec*1000000000ull+ts.tv_nsec;
+	}
+	static uint64_t rss(){
+		long pages = 0;
+		FILE* f = fopen("/proc/self/statm","r");
+		if(f!=NULL){
+			if(fscanf(f,"%*s %ld",&pages)!=1){
+				pages = 0;
+			}
+			fclose(f);
+		}
+		return (uint64_t)pages*sysconf(_SC_PAGESIZE);
+	}
+
+	void sample(uint64_t t0){
+		Sample s;
+		s.ns = now()-t0;
+		s.ops = 0;
+		for(int i = 0; i<gtc->task_num; i++){
+			s.ops += ops[i].ui.load(std::memory_order_relaxed);
+		}
+		s.unreclaimed = rm? rm->unreclaimed() : 0;
+		s.unreclaimed_bytes = rm? rm->unreclaimed_bytes() : 0;
+		s.pinned_bytes = rm? rm->pinned_bytes() : 0;
+		s.epoch = rm? rm->epoch() : 0;
+		s.rss = rss();
+		samples.push_back(s);
+	}
+
+	void run(){
+		uint64_t t0 = now();
+		uint64_t next = t0;
+		while(!gtc->stop.load(std::memory_order_acquire)){
+			sample(t0);
+			next += (uint64_t)interval_ms*1000000;
+			struct timespec deadline;
+			deadline.tv_sec = next/1000000000;
+			deadline.tv_nsec = next%1000000000;
+			while(clock_nanosleep(CLOCK_MONOTONIC,TIMER_ABSTIME,&deadline,NULL)==EINTR);
+		}
+		sample(t0);
+	}
+
+	void write(){
+		bool fresh = access(path.c_str(),F_OK)==-1;
+		FILE* f = fopen(path.c_str(),"a");
+		if(f==NULL){
+			errexit("Unable to open time series output file.");
+		}
+		if(fresh){
+			fprintf(f,"datetime,rideable,environment,threads,time_ms,ops,ops_per_sec,"
+				"unreclaimed,unreclaimed_bytes,pinned_bytes,epoch,rss_bytes\n");
+		}
+		std::string run = gtc->recorder->globalFields["datetime"]+","+gtc->getRideableName()
+			+","+gtc->recorder->globalFields["environment"]+","+std::to_string(gtc->task_num);
+		for(size_t i = 0; i<samples.size(); i++){
+			const Sample& s = samples[i];
+			double rate = 0;
+			if(i>0 && s.ns>samples[i-1].ns){
+				rate = (s.ops-samples[i-1].ops)*1e9/(s.ns-samples[i-1].ns);
+			}
+			fprintf(f,"%s,%.3f,%lu,%.0f,%lu,%lu,%lu,%lu,%lu\n",run.c_str(),s.ns/1e6,
+				s.ops,rate,s.unreclaimed,s.unreclaimed_bytes,s.pinned_bytes,s.epoch,s.rss);
+		}
+		fclose(f);
+	}
+
+public:
+	// default_ms is the interval used when -d sample is not given
+	void init(GlobalTestConfig* gtc, Rideable* r, int default_ms = 0){
+		this->gtc = gtc;
+		rm = dynamic_cast<RetiredMonitorable*>(r);
+		interval_ms = gtc->checkEnv("sample")? atoi((gtc->getEnv("sample")).c_str()) : default_ms;
+		ops = new paddedAtomic<uint64_t>[gtc->task_num];
+		for(int i = 0; i<gtc->task_num; i++){
+			ops[i].ui.store(0,std::memory_order_relaxed);
+		}
+		if(interval_ms<=0){
+			return;
+		}
+		path = gtc->getEnv("series");
+		if(path==""){
+			path = gtc->outFile.size()>0? gtc->outFile : "out.csv";
+			if(path.size()>4 && path.compare(path.size()-4,4,".csv")==0){
+				path.erase(path.size()-4);
+			}
+			path += "_series.csv";
+		}
+	}
+
+	void start(int tid){
+		if(tid==0 && interval_ms>0){
+			sampler = std::thread(&TimeSeries::run,this);
+		}
+	}
+	inline void progress(int tid, uint64_t n){
+		ops[tid].ui.store(n,std::memory_order_relaxed);
+	}
+	void finish(int tid){
+		if(tid==0 && interval_ms>0){
+			sampler.join();
+			write();
+		}
+	}
+
+	// peaks over the samples, once finish() has run
+	uint64_t peak_unreclaimed(){
+		uint64_t p = 0;
+		for(const Sample& s : samples){
+			p = std::max(p,s.unreclaimed);
+		}
+		return p;
+	}
+	uint64_t peak_unreclaimed_bytes(){
+		uint64_t p = 0;
+		for(const Sample& s : samples){
+			p = std::max(p,s.unreclaimed_bytes);
+		}
+		return p;
+	}
+	uint64_t peak_rss(){
+		uint64_t p = 0;
+		for(const Sample& s : samples){
+			p = std::max(p,s.rss);
+		}
+		return p;
+	}
+};
+
+#endif
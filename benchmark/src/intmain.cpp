@@ -31,6 +31,11 @@ limitations under the License.
 #include "rideables/LinkList.hpp"
 #include "rideables/WFQueue.hpp"
 #include "rideables/CRTurnQueue.hpp"
+#include "rideables/MSQueue.hpp"
+#include "rideables/TreiberStack.hpp"
+#include "rideables/TreapTree.hpp"
+#include "rideables/ABTree.hpp"
+#include "rideables/RadixTree.hpp"
 
 #if (__x86_64__ || __ppc64__)
 #include "rideables/SortedUnorderedMapRange.hpp"
@@ -67,6 +72,11 @@ int main(int argc, char *argv[])
 
 	gtc->addRideableOption(new WFQueueFactory<int,int>(), "WFQueue");
 	gtc->addRideableOption(new CRTurnQueueFactory<int,int>(), "CRTurnQueue");
+	gtc->addRideableOption(new MSQueueFactory<int,int>(), "MSQueue");
+	gtc->addRideableOption(new TreiberStackFactory<int,int>(), "TreiberStack");
+	gtc->addRideableOption(new TreapTreeFactory<int,int>(), "TreapTree");
+	gtc->addRideableOption(new ABTreeFactory<int,int>(), "ABTree");
+	gtc->addRideableOption(new RadixTreeFactory<int>(), "RadixTree");
 
 	//gtc->addRideableOption(new SortedUnorderedMapHazardFactory<int,int>(), "SortedUnorderedMapHazard");
 	// gtc->addRideableOption(new SortedUnorderedMapRCUFactory<int,int>(), "SortedUnorderedMapRCU");
@@ -95,6 +105,18 @@ int main(int argc, char *argv[])
 	gtc->addTestOption(new ObjRetireTest<int>(90,0,10,0,0,100000,50000), "ObjRetire:g90p10:range=100000:prefill=50000");
 	gtc->addTestOption(new ObjRetireTest<int>(0,0,0,50,50,100000,50000), "ObjRetire:i50rm50:range=100000:prefill=50000");
 	gtc->addTestOption(new ObjRetireTest<int>(0,0,0,50,50,65536,1024), "ObjRetire:i50rm50:range=65536:prefill=1024");
+	gtc->addTestOption(new SeqInsertTest<int>(8192), "SeqInsert:window=8192");
+	gtc->addTestOption(new RangeScanTest<int>(1000,10,65536,32768), "RangeScan:s1000u10:range=65536:prefill=32768");
+	gtc->addTestOption(new StallTest<int>(1,500,65536,32768), "Stall:stalled=1:stall=500ms:range=65536:prefill=32768");
+	gtc->addTestOption(new EpochStormTest<int>(1,10,2048,1024), "EpochStorm:storms=1:u10:range=2048:prefill=1024");
+	gtc->addTestOption(new TrackerBenchTest(TrackerBenchTest::READ), "TrackerRead");
+	gtc->addTestOption(new TrackerBenchTest(TrackerBenchTest::STALE_READ), "TrackerStaleRead");
+	gtc->addTestOption(new TrackerBenchTest(TrackerBenchTest::RETIRE), "TrackerRetire");
+	gtc->addTestOption(new TrackerBenchTest(TrackerBenchTest::SCAN), "TrackerEmpty");
+	gtc->addTestOption(new TrackerBenchTest(TrackerBenchTest::ALLOC), "TrackerAlloc");
+	gtc->addTestOption(new QueueTest<int>(QueueTest<int>::PAIRS,1000), "QueuePairs:prefill=1000");
+	gtc->addTestOption(new QueueTest<int>(QueueTest<int>::RANDOM,1000), "QueueRandom:prefill=1000");
+	gtc->addTestOption(new QueueTest<int>(QueueTest<int>::PRODCON,0), "QueueProdCons:prefill=0");
 
 	// gtc->addTestOption(new MapOrderedGet<int>(65536, 5000), "MapOrderedGetPut:range=65536:prefill=5000");
 	// gtc->addTestOption(new MapChurnTest<int>(50,0,0,50,0,8000,1024), "MapChurn:g50i50:range=8K:prefill=1024");
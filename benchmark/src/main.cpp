@@ -30,6 +30,10 @@ limitations under the License.
 #include "rideables/LinkList.hpp"
 #include "rideables/WFQueue.hpp"
 #include "rideables/CRTurnQueue.hpp"
+#include "rideables/MSQueue.hpp"
+#include "rideables/TreiberStack.hpp"
+#include "rideables/TreapTree.hpp"
+#include "rideables/ABTree.hpp"
 
 #if (__x86_64__ || __ppc64__)
 #include "rideables/SortedUnorderedMapRange.hpp"
@@ -67,6 +71,11 @@ int main(int argc, char *argv[])
 
 	gtc->addRideableOption(new CRTurnQueueFactory<std::string,std::string>(), "CRTurnQueue");
 
+	gtc->addRideableOption(new MSQueueFactory<std::string,std::string>(), "MSQueue");
+	gtc->addRideableOption(new TreiberStackFactory<std::string,std::string>(), "TreiberStack");
+	gtc->addRideableOption(new TreapTreeFactory<std::string,std::string>(), "TreapTree");
+	gtc->addRideableOption(new ABTreeFactory<std::string,std::string>(), "ABTree");
+
 	//gtc->addRideableOption(new SortedUnorderedMapHazardFactory<std::string,std::string>(), "SortedUnorderedMapHazard");
 	// gtc->addRideableOption(new SortedUnorderedMapRCUFactory<std::string,std::string>(), "SortedUnorderedMapRCU");
 	//gtc->addRideableOption(new SortedUnorderedMapHEFactory<std::string,std::string>(), "SortedUnorderedMapHE");
@@ -96,6 +105,18 @@ int main(int argc, char *argv[])
 	gtc->addTestOption(new ObjRetireTest<string>(90,0,10,0,0,100000,50000), "ObjRetire:g90p10:range=100000:prefill=50000");
 	gtc->addTestOption(new ObjRetireTest<string>(0,0,0,50,50,100000,50000), "ObjRetire:i50rm50:range=100000:prefill=50000");
 	gtc->addTestOption(new ObjRetireTest<string>(0,0,0,50,50,65536,1024), "ObjRetire:i50rm50:range=65536:prefill=1024");
+	gtc->addTestOption(new SeqInsertTest<string>(8192), "SeqInsert:window=8192");
+	gtc->addTestOption(new RangeScanTest<string>(1000,10,65536,32768), "RangeScan:s1000u10:range=65536:prefill=32768");
+	gtc->addTestOption(new StallTest<string>(1,500,65536,32768), "Stall:stalled=1:stall=500ms:range=65536:prefill=32768");
+	gtc->addTestOption(new EpochStormTest<string>(1,10,2048,1024), "EpochStorm:storms=1:u10:range=2048:prefill=1024");
+	gtc->addTestOption(new TrackerBenchTest(TrackerBenchTest::READ), "TrackerRead");
+	gtc->addTestOption(new TrackerBenchTest(TrackerBenchTest::STALE_READ), "TrackerStaleRead");
+	gtc->addTestOption(new TrackerBenchTest(TrackerBenchTest::RETIRE), "TrackerRetire");
+	gtc->addTestOption(new TrackerBenchTest(TrackerBenchTest::SCAN), "TrackerEmpty");
+	gtc->addTestOption(new TrackerBenchTest(TrackerBenchTest::ALLOC), "TrackerAlloc");
+	gtc->addTestOption(new QueueTest<string>(QueueTest<string>::PAIRS,1000), "QueuePairs:prefill=1000");
+	gtc->addTestOption(new QueueTest<string>(QueueTest<string>::RANDOM,1000), "QueueRandom:prefill=1000");
+	gtc->addTestOption(new QueueTest<string>(QueueTest<string>::PRODCON,0), "QueueProdCons:prefill=0");
 
 	// gtc->addTestOption(new MapOrderedGet<std::string>(65536, 5000), "MapOrderedGetPut:range=65536:prefill=5000");
 	// gtc->addTestOption(new MapChurnTest<string>(50,0,0,30,20,65536,5000), "MapChurn:g50i30rm20:range=65536:prefill=5000");
@@ -0,0 +1,641 @@
+/*
+
+Copyright 2017 University of Rochester
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*/
+
+
+#ifndef AB_TREE
+#define AB_TREE
+
+#include <iostream>
+#include <atomic>
+#include <algorithm>
+#include "Harness.hpp"
+#include "ConcurrentPrimitives.hpp"
+#include "ROrderedMap.hpp"
+#include "RUnorderedMap.hpp"
+#include "MemoryTracker.hpp"
+#include "RetiredMonitorable.hpp"
+#include "LLXSCX.hpp"
+
+#ifdef NGC
+#define COLLECT false
+#else
+#define COLLECT true
+#endif
+
+/*
+ * A lock-free relaxed (a,b)-tree after Brown [PhD thesis, 2017],
+ * built with the LLX/SCX tree update template. Leaves hold up to B
+ * sorted keys and internal nodes up to B children, so a lookup makes
+ * one protected read() per level and a tree of n keys has about
+ * n/B*2 nodes instead of 2n.
+ *
+ * Nodes are immutable apart from child pointers: every update builds
+ * a new leaf (or a few new nodes when rebalancing) and retires the
+ * whole nodes it replaces. An insert into a full leaf splits it under
+ * a tagged internal node, and a delete may leave a leaf with fewer
+ * than A keys; both violations are fixed later on the search path by
+ * absorb/split and join/distribute steps.
+ */
+template <class K, class V>
+class ABTree : public ROrderedMap<K,V>, public RetiredMonitorable{
+private:
+	static const int B = 16;//max keys in a leaf, max children of an internal node
+	static const int A = 6;//min for nodes other than the root, B >= 2A-1
+
+	/* structs*/
+	struct Node{
+		bool leaf;
+		bool tagged;
+		int size;//keys in a leaf, children of an internal node
+		std::atomic<uint64_t> info;
+		std::atomic<bool> marked;
+		K keys[B];//size-1 routing keys in an internal node
+		V vals[B];
+		std::atomic<Node*> child[B];
+
+		inline bool deletable() {return true;}
+		Node(bool lf, bool tg, int sz):leaf(lf),tagged(tg),size(sz),info(0),marked(false){};
+	};
+	struct SeekRecord{
+		Node* gp;
+		Node* p;
+		Node* l;
+		int pidx;//index of p in gp
+		int lidx;//index of l in p
+	};
+	enum UpdateMode {INSERT, PUT, REPLACE};
+
+	/* variables */
+	MemoryTracker<Node>* memory_tracker;
+	LLXSCX<Node,4>* prim;
+	Node* entry;//sentinel with the root as its only child
+
+	const int kGp = 0;
+	const int kP = 1;
+	const int kL = 2;
+	const int kNext = 3;
+	const int kSib = 4;
+	const int kHelp = 5;//4 slots for helping an SCX
+	//reservation slots of rangeScan: the current node and its child
+	static const int SCAN_CUR = 0;
+	static const int SCAN_CHILD = 1;
+
+	/* helper functions */
+	inline Node* mkNode(bool lf, bool tg, int sz, int tid){
+		void* ptr = memory_tracker->alloc(tid);
+		return new (ptr) Node(lf,tg,sz);
+	}
+	inline Node* mkInternal(bool tg, int sz, Node** kids, K* ks, int tid){
+		Node* n = mkNode(false,tg,sz,tid);
+		for(int i=0;i<sz;i++){
+			n->child[i].store(kids[i],std::memory_order_relaxed);
+		}
+		for(int i=0;i<sz-1;i++){
+			n->keys[i]=ks[i];
+		}
+		return n;
+	}
+	inline Node* mkLeaf(int sz, K* ks, V* vs, int tid){
+		Node* n = mkNode(true,false,sz,tid);
+		for(int i=0;i<sz;i++){
+			n->keys[i]=ks[i];
+			n->vals[i]=vs[i];
+		}
+		return n;
+	}
+	inline int childIndex(Node* n, K& key){
+		int i=0;
+		while(i<n->size-1 && !(key<n->keys[i])) i++;
+		return i;
+	}
+	inline int keyIndex(Node* l, K& key){
+		for(int i=0;i<l->size;i++){
+			if(l->keys[i]==key) return i;
+		}
+		return -1;
+	}
+
+	/* private interfaces */
+	bool search(K key, int tid, SeekRecord& rec, bool violation);
+	void fixTagged(SeekRecord& rec, int tid);
+	void fixUnderfull(SeekRecord& rec, int tid);
+	void cleanup(K key, int tid);
+	optional<V> update(K key, V val, UpdateMode mode, bool& inserted, int tid);
+	bool doRangeScan(K& lo, const K& hi, bool& exclusive, int& cnt, RangeVisitor<K,V>* visitor, int tid);
+public:
+	ABTree(GlobalTestConfig* gtc): RetiredMonitorable(gtc){
+		int epochf = gtc->getEnv("epochf").empty()? 150:stoi(gtc->getEnv("epochf"));
+		int emptyf = gtc->getEnv("emptyf").empty()? 30:stoi(gtc->getEnv("emptyf"));
+		memory_tracker = new MemoryTracker<Node>(gtc, epochf, emptyf, 9, COLLECT);
+		monitor(memory_tracker);
+		prim = new LLXSCX<Node,4>(gtc, memory_tracker, kHelp);
+		entry = mkNode(false,false,1,0);
+		entry->child[0].store(mkNode(true,false,0,0));
+	};
+	~ABTree(){};
+
+	optional<V> get(K key, int tid);
+	optional<V> put(K key, V val, int tid);
+	bool insert(K key, V val, int tid);
+	optional<V> remove(K key, int tid);
+	optional<V> replace(K key, V val, int tid);
+	std::map<K, V> rangeQuery(K key1, K key2, int& len, int tid);
+	int rangeScan(K key1, K key2, RangeVisitor<K,V>* visitor, int tid);
+};
+
+template <class K, class V>
+class ABTreeFactory : public RideableFactory{
+	ABTree<K,V>* build(GlobalTestConfig* gtc){
+		return new ABTree<K,V>(gtc);
+	}
+};
+
+//-------Definition----------
+/*
+ * Finds the leaf for key and leaves gp, p and l reserved in slots
+ * kGp, kP and kL. With violation set, stops early and returns true
+ * at the first tagged node, or non-root node with fewer than A
+ * keys or children.
+ */
+template <class K, class V>
+bool ABTree<K,V>::search(K key, int tid, SeekRecord& rec, bool violation){
+	while(true){
+		Node* gp=nullptr;
+		Node* p=entry;//never retired
+		Node* l=memory_tracker->read(entry->child[0],kL,tid,entry);
+		int pidx=0;
+		int lidx=0;
+		bool found=violation && l->tagged;
+		bool restart=false;
+		while(!found && !l->leaf){
+			int idx=childIndex(l,key);
+			Node* next=memory_tracker->read(l->child[idx],kNext,tid,l);
+			/*
+			 * l is still in the tree, so next was not retired
+			 * before we reserved it.
+			 */
+			if(l->marked.load()){
+				restart=true;
+				break;
+			}
+			memory_tracker->transfer(kP,kGp,tid);
+			memory_tracker->transfer(kL,kP,tid);
+			memory_tracker->transfer(kNext,kL,tid);
+			gp=p;
+			p=l;
+			l=next;
+			pidx=lidx;
+			lidx=idx;
+			found=violation && (l->tagged || l->size<A);
+		}
+		if(restart) continue;
+		rec.gp=gp;
+		rec.p=p;
+		rec.l=l;
+		rec.pidx=pidx;
+		rec.lidx=lidx;
+		return found;
+	}
+}
+
+/* absorbs tagged rec.l into its parent, splitting the parent if it gets too big */
+template <class K, class V>
+void ABTree<K,V>::fixTagged(SeekRecord& rec, int tid){
+	typedef typename LLXSCX<Node,4>::LLXResult LLXResult;
+	const LLXResult ok = LLXSCX<Node,4>::LLX_SNAPSHOT;
+	Node* gp=rec.gp;
+	Node* p=rec.p;
+	Node* t=rec.l;
+	uint64_t infos[3];
+	Node* gsnap[B];
+	Node* psnap[B];
+	Node* tsnap[B];
+
+	if(p==entry){//the root only needs its tag removed
+		Node* nodes[2]={entry,t};
+		if(prim->llx(entry,psnap,1,&infos[0],tid)!=ok || psnap[0]!=t) return;
+		if(prim->llx(t,tsnap,t->size,&infos[1],tid)!=ok) return;
+		Node* n=mkInternal(false,t->size,tsnap,t->keys,tid);
+		if(prim->scx(nodes,infos,2,0x2,&entry->child[0],t,n,tid)){
+			memory_tracker->retire(t,tid);
+		}
+		else{
+			memory_tracker->reclaim(n,tid);
+		}
+		return;
+	}
+
+	Node* nodes[3]={gp,p,t};
+	if(prim->llx(gp,gsnap,gp->size,&infos[0],tid)!=ok || gsnap[rec.pidx]!=p) return;
+	if(prim->llx(p,psnap,p->size,&infos[1],tid)!=ok || psnap[rec.lidx]!=t) return;
+	if(prim->llx(t,tsnap,2,&infos[2],tid)!=ok) return;
+
+	/* children and keys of p with t's two children in t's place */
+	int sz=p->size+1;
+	int ti=rec.lidx;
+	Node* kids[B+1];
+	K ks[B];
+	for(int i=0;i<ti;i++) kids[i]=psnap[i];
+	kids[ti]=tsnap[0];
+	kids[ti+1]=tsnap[1];
+	for(int i=ti+1;i<p->size;i++) kids[i+1]=psnap[i];
+	for(int i=0;i<ti;i++) ks[i]=p->keys[i];
+	ks[ti]=t->keys[0];
+	for(int i=ti;i<p->size-1;i++) ks[i+1]=p->keys[i];
+
+	Node* n=nullptr;
+	Node* left=nullptr;
+	Node* right=nullptr;
+	if(sz<=B){//absorb
+		n=mkInternal(false,sz,kids,ks,tid);
+	}
+	else{//split; the tag moves up unless the new node is the root
+		int ls=sz/2;
+		left=mkInternal(false,ls,kids,ks,tid);
+		right=mkInternal(false,sz-ls,kids+ls,ks+ls,tid);
+		Node* halves[2]={left,right};
+		n=mkInternal(gp!=entry,2,halves,ks+ls-1,tid);
+	}
+	if(prim->scx(nodes,infos,3,0x6,&gp->child[rec.pidx],p,n,tid)){
+		memory_tracker->retire(p,tid);
+		memory_tracker->retire(t,tid);
+	}
+	else{
+		memory_tracker->reclaim(n,tid);
+		if(left!=nullptr){
+			memory_tracker->reclaim(left,tid);
+			memory_tracker->reclaim(right,tid);
+		}
+	}
+}
+
+/* joins underfull rec.l with a sibling, or evens out their sizes */
+template <class K, class V>
+void ABTree<K,V>::fixUnderfull(SeekRecord& rec, int tid){
+	typedef typename LLXSCX<Node,4>::LLXResult LLXResult;
+	const LLXResult ok = LLXSCX<Node,4>::LLX_SNAPSHOT;
+	Node* gp=rec.gp;
+	Node* p=rec.p;
+	Node* u=rec.l;
+	uint64_t infos[4];
+	Node* gsnap[B];
+	Node* psnap[B];
+	Node* usnap[B];
+	Node* ssnap[B];
+
+	if(prim->llx(gp,gsnap,gp->size,&infos[0],tid)!=ok || gsnap[rec.pidx]!=p) return;
+	if(prim->llx(p,psnap,p->size,&infos[1],tid)!=ok || psnap[rec.lidx]!=u) return;
+	int ui=rec.lidx;
+	int si=(ui+1<p->size)? ui+1:ui-1;
+	Node* s=psnap[si];
+	memory_tracker->reserve_slot(s,kSib,tid,p);
+	// as in search(): s stays alive while p is in the tree
+	if(p->marked.load() || p->child[si].load()!=s) return;
+	if(prim->llx(u,usnap,u->leaf?0:u->size,&infos[2],tid)!=ok) return;
+	if(prim->llx(s,ssnap,s->leaf?0:s->size,&infos[3],tid)!=ok) return;
+	if(s->tagged){
+		SeekRecord srec={gp,p,s,rec.pidx,si};
+		fixTagged(srec,tid);
+		return;
+	}
+
+	int li=std::min(ui,si);
+	Node* left=(li==ui)? u:s;
+	Node* right=(li==ui)? s:u;
+	Node** lsnap=(li==ui)? usnap:ssnap;
+	Node** rsnap=(li==ui)? ssnap:usnap;
+	uint64_t sinfos[4]={infos[0],infos[1],(li==ui)? infos[2]:infos[3],(li==ui)? infos[3]:infos[2]};
+	Node* nodes[4]={gp,p,left,right};
+	bool leaf=u->leaf;
+	int total=left->size+right->size;
+
+	/* everything under left and right, in order */
+	K ks[2*B];
+	V vs[2*B];
+	Node* kids[2*B];
+	if(leaf){
+		for(int i=0;i<left->size;i++){
+			ks[i]=left->keys[i];
+			vs[i]=left->vals[i];
+		}
+		for(int i=0;i<right->size;i++){
+			ks[left->size+i]=right->keys[i];
+			vs[left->size+i]=right->vals[i];
+		}
+	}
+	else{
+		for(int i=0;i<left->size;i++) kids[i]=lsnap[i];
+		for(int i=0;i<right->size;i++) kids[left->size+i]=rsnap[i];
+		for(int i=0;i<left->size-1;i++) ks[i]=left->keys[i];
+		ks[left->size-1]=p->keys[li];
+		for(int i=0;i<right->size-1;i++) ks[left->size+i]=right->keys[i];
+	}
+
+	Node* n=nullptr;
+	Node* m=nullptr;
+	Node* m2=nullptr;
+	Node* pkids[B];
+	K pks[B];
+	if(total<2*A){//join
+		m=leaf? mkLeaf(total,ks,vs,tid) : mkInternal(false,total,kids,ks,tid);
+		if(gp==entry && p->size==2){//root absorbs its only child
+			n=m;
+		}
+		else{
+			for(int i=0,j=0;i<p->size;i++){
+				if(i==li+1) continue;
+				pkids[j++]=(i==li)? m:psnap[i];
+			}
+			for(int i=0,j=0;i<p->size-1;i++){
+				if(i==li) continue;
+				pks[j++]=p->keys[i];
+			}
+			n=mkInternal(false,p->size-1,pkids,pks,tid);
+		}
+	}
+	else{//distribute
+		int ls=total/2;
+		if(leaf){
+			m=mkLeaf(ls,ks,vs,tid);
+			m2=mkLeaf(total-ls,ks+ls,vs+ls,tid);
+		}
+		else{
+			m=mkInternal(false,ls,kids,ks,tid);
+			m2=mkInternal(false,total-ls,kids+ls,ks+ls,tid);
+		}
+		for(int i=0;i<p->size;i++) pkids[i]=psnap[i];
+		pkids[li]=m;
+		pkids[li+1]=m2;
+		for(int i=0;i<p->size-1;i++) pks[i]=p->keys[i];
+		pks[li]=leaf? ks[ls]:ks[ls-1];
+		n=mkInternal(false,p->size,pkids,pks,tid);
+	}
+	if(prim->scx(nodes,sinfos,4,0xE,&gp->child[rec.pidx],p,n,tid)){
+		memory_tracker->retire(p,tid);
+		memory_tracker->retire(left,tid);
+		memory_tracker->retire(right,tid);
+	}
+	else{
+		if(n!=m) memory_tracker->reclaim(n,tid);
+		memory_tracker->reclaim(m,tid);
+		if(m2!=nullptr) memory_tracker->reclaim(m2,tid);
+	}
+}
+
+/* fixes violations on the search path for key */
+template <class K, class V>
+void ABTree<K,V>::cleanup(K key, int tid){
+	SeekRecord rec;
+	while(search(key,tid,rec,true)){
+		if(rec.l->tagged)
+			fixTagged(rec,tid);
+		else
+			fixUnderfull(rec,tid);
+	}
+}
+
+template <class K, class V>
+optional<V> ABTree<K,V>::update(K key, V val, UpdateMode mode, bool& inserted, int tid){
+	typedef typename LLXSCX<Node,4>::LLXResult LLXResult;
+	const LLXResult ok = LLXSCX<Node,4>::LLX_SNAPSHOT;
+	optional<V> res={};
+	SeekRecord rec;
+	inserted=false;
+	collect_retired_size(memory_tracker->get_retired_cnt(tid), tid);
+	memory_tracker->start_op(tid);
+	while(true){
+		search(key,tid,rec,false);
+		Node* p=rec.p;
+		Node* l=rec.l;
+		int pos=keyIndex(l,key);
+		if((pos>=0 && mode==INSERT) || (pos<0 && mode==REPLACE)){
+			break;
+		}
+
+		Node* nodes[2]={p,l};
+		uint64_t infos[2];
+		Node* psnap[B];
+		if(prim->llx(p,psnap,p->size,&infos[0],tid)!=ok || psnap[rec.lidx]!=l) continue;
+		if(prim->llx(l,nullptr,0,&infos[1],tid)!=ok) continue;
+
+		Node* n=nullptr;
+		Node* left=nullptr;
+		Node* right=nullptr;
+		if(pos>=0){//new value for an existing key
+			n=mkLeaf(l->size,l->keys,l->vals,tid);
+			n->vals[pos]=val;
+		}
+		else{
+			/* l's keys with the new one in order */
+			K ks[B+1];
+			V vs[B+1];
+			int j=0;
+			for(int i=0;i<l->size;i++){
+				if(j==i && key<l->keys[i]){
+					ks[j]=key;
+					vs[j++]=val;
+				}
+				ks[j]=l->keys[i];
+				vs[j++]=l->vals[i];
+			}
+			if(j==l->size){
+				ks[j]=key;
+				vs[j++]=val;
+			}
+			if(j<=B){
+				n=mkLeaf(j,ks,vs,tid);
+			}
+			else{//split under a tagged node, unless it is the new root
+				int ls=j/2;
+				left=mkLeaf(ls,ks,vs,tid);
+				right=mkLeaf(j-ls,ks+ls,vs+ls,tid);
+				Node* halves[2]={left,right};
+				n=mkInternal(p!=entry,2,halves,ks+ls,tid);
+			}
+		}
+		bool tagged=n->tagged;// n is not reserved once it is in the tree
+		if(prim->scx(nodes,infos,2,0x2,&p->child[rec.lidx],l,n,tid)){
+			if(pos>=0){
+				res=l->vals[pos];
+			}
+			else{
+				inserted=true;
+			}
+			memory_tracker->retire(l,tid);
+			if(tagged){
+				cleanup(key,tid);
+			}
+			break;
+		}
+		memory_tracker->reclaim(n,tid);
+		if(left!=nullptr){
+			memory_tracker->reclaim(left,tid);
+			memory_tracker->reclaim(right,tid);
+		}
+	}
+	memory_tracker->clear_all(tid);
+	memory_tracker->end_op(tid);
+	return res;
+}
+
+template <class K, class V>
+optional<V> ABTree<K,V>::get(K key, int tid){
+	optional<V> res={};
+	SeekRecord rec;
+	collect_retired_size(memory_tracker->get_retired_cnt(tid), tid);
+	memory_tracker->start_op(tid);
+	search(key,tid,rec,false);
+	int pos=keyIndex(rec.l,key);
+	if(pos>=0){
+		res=rec.l->vals[pos];
+	}
+	memory_tracker->clear_all(tid);
+	memory_tracker->end_op(tid);
+	return res;
+}
+
+template <class K, class V>
+optional<V> ABTree<K,V>::put(K key, V val, int tid){
+	bool inserted;
+	return update(key,val,PUT,inserted,tid);
+}
+
+template <class K, class V>
+bool ABTree<K,V>::insert(K key, V val, int tid){
+	bool inserted;
+	update(key,val,INSERT,inserted,tid);
+	return inserted;
+}
+
+template <class K, class V>
+optional<V> ABTree<K,V>::replace(K key, V val, int tid){
+	bool inserted;
+	return update(key,val,REPLACE,inserted,tid);
+}
+
+template <class K, class V>
+optional<V> ABTree<K,V>::remove(K key, int tid){
+	typedef typename LLXSCX<Node,4>::LLXResult LLXResult;
+	const LLXResult ok = LLXSCX<Node,4>::LLX_SNAPSHOT;
+	optional<V> res={};
+	SeekRecord rec;
+	collect_retired_size(memory_tracker->get_retired_cnt(tid), tid);
+	memory_tracker->start_op(tid);
+	while(true){
+		search(key,tid,rec,false);
+		Node* p=rec.p;
+		Node* l=rec.l;
+		int pos=keyIndex(l,key);
+		if(pos<0){
+			break;
+		}
+
+		Node* nodes[2]={p,l};
+		uint64_t infos[2];
+		Node* psnap[B];
+		if(prim->llx(p,psnap,p->size,&infos[0],tid)!=ok || psnap[rec.lidx]!=l) continue;
+		if(prim->llx(l,nullptr,0,&infos[1],tid)!=ok) continue;
+
+		/* copy of l without the key */
+		Node* n=mkNode(true,false,l->size-1,tid);
+		for(int i=0,j=0;i<l->size;i++){
+			if(i==pos) continue;
+			n->keys[j]=l->keys[i];
+			n->vals[j++]=l->vals[i];
+		}
+		bool underfull=(p!=entry && n->size<A);// n is not reserved once it is in the tree
+		if(prim->scx(nodes,infos,2,0x2,&p->child[rec.lidx],l,n,tid)){
+			res=l->vals[pos];
+			memory_tracker->retire(l,tid);
+			if(underfull){
+				cleanup(key,tid);
+			}
+			break;
+		}
+		memory_tracker->reclaim(n,tid);
+	}
+	memory_tracker->clear_all(tid);
+	memory_tracker->end_op(tid);
+	return res;
+}
+
+template <class K, class V>
+std::map<K, V> ABTree<K,V>::rangeQuery(K key1, K key2, int& len, int tid){
+	RangeCollector<K,V> collector;
+	len=rangeScan(key1,key2,&collector,tid);
+	return collector.res;
+}
+
+template <class K, class V>
+int ABTree<K,V>::rangeScan(K key1, K key2, RangeVisitor<K,V>* visitor, int tid){
+	if(key1>key2) return 0;
+	K lo=key1;//scan cursor
+	bool exclusive=false;
+	int cnt=0;
+
+	collect_retired_size(memory_tracker->get_retired_cnt(tid), tid);
+	memory_tracker->start_op(tid);
+	while(!doRangeScan(lo,key2,exclusive,cnt,visitor,tid)){}
+	memory_tracker->clear_all(tid);
+	memory_tracker->end_op(tid);
+	return cnt;
+}
+
+/*
+ * Descends to the leaf holding the cursor lo and visits its keys up to
+ * hi. A child is trusted only if its parent is still unmarked after the
+ * read, as in search(), so two reservation slots suffice. The smallest
+ * routing key right of the path bounds the leaf; the next leaf is found
+ * by descending again from that bound. Returns false to descend again,
+ * from the bound or, if the path went off the tree, after the last
+ * visited key.
+ */
+template <class K, class V>
+bool ABTree<K,V>::doRangeScan(K& lo, const K& hi, bool& exclusive, int& cnt, RangeVisitor<K,V>* visitor, int tid){
+	Node* n=entry;//never retired
+	K bound=lo;
+	bool bounded=false;
+	while(!n->leaf){
+		int idx=childIndex(n,lo);
+		Node* child=memory_tracker->read(n->child[idx],SCAN_CHILD,tid,n);
+		if(n->marked.load())
+			return false;
+		if(idx<n->size-1){
+			bound=n->keys[idx];
+			bounded=true;
+		}
+		memory_tracker->transfer(SCAN_CHILD,SCAN_CUR,tid);
+		n=child;
+	}
+	for(int i=0;i<n->size;i++){
+		if(hi<n->keys[i])
+			return true;
+		if(lo<n->keys[i] || (!exclusive && !(n->keys[i]<lo))){
+			visitor->visit(n->keys[i],n->vals[i]);
+			cnt++;
+			lo=n->keys[i];
+			exclusive=true;
+		}
+	}
+	if(!bounded || hi<bound)
+		return true;
+	lo=bound;
+	exclusive=false;
+	return false;
+}
+#endif
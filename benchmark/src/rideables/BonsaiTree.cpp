@@ -23,6 +23,8 @@ limitations under the License.
 #include <iostream>
 #include <list>
 #include <map>
+#include <vector>
+#include <thread>
 
 //#defiine LAZY_TRACKER
 
@@ -31,7 +33,7 @@ using namespace std;
 /* routines under State */
 template<class K, class V>
 BonsaiTree<K, V>::State::State(MemoryTracker<Node>* tracker): 
-	root(NULL), next(NULL){
+	root(NULL), next(NULL), arena(NULL){
 		memory_tracker = tracker;
 	}
 
@@ -39,16 +41,12 @@ template<class K, class V>
 BonsaiTree<K, V>::State::State(BonsaiTree<K, V>::Node* r, BonsaiTree<K, V>::Node* n){
 	root = r;
 	next = n;
+	arena = NULL;
 }
 
 template<class K, class V>
 BonsaiTree<K, V>::State::~State(){}
 
-template<class K, class V>
-void BonsaiTree<K, V>::State::addNewNode(BonsaiTree<K, V>::Node* new_node){
-	new_list.push_back(new_node);
-}
-
 
 /* routines under BonsaiTree<K, V>::Node*/
 template<class K, class V>
@@ -67,22 +65,43 @@ BonsaiTree<K, V>::Node::Node(BonsaiTree<K, V>::Node* l, BonsaiTree<K, V>::Node*
 template<class K, class V>
 BonsaiTree<K, V>::Node::Node(State* state): state(state){}
 
+template<class K, class V>
+BonsaiTree<K, V>::Node::Node(Arena* arena): guarded(arena){}
+
 
 template<class K, class V>
 BonsaiTree<K, V>::Node::~Node() {
 	if(state){
 		delete state;
 	}
+	if(guarded){
+		for(int i = 0; i < guarded->used; i++){
+			guarded->slot(i)->~Node();
+		}
+		guarded->~Arena();
+		free(guarded);
+	}
 }
 
 /* routines under BonsaiTree */
 template<class K, class V>
 BonsaiTree<K, V>::BonsaiTree(GlobalTestConfig* gtc): RetiredMonitorable(gtc){
 	std::string type = gtc->getEnv("tracker");
-	if (type == "Hazard" || type == "HE" || type == "WFE") errexit("Hazard, HE, and WFE not available ");
+	if (type == "Hazard") errexit("Hazard not available ");
 	int epochf = gtc->getEnv("epochf").empty()? 150:stoi(gtc->getEnv("epochf"));
 	int emptyf = gtc->getEnv("emptyf").empty()? 30:stoi(gtc->getEnv("emptyf"));
 	memory_tracker = new MemoryTracker<Node>(gtc, epochf, emptyf, 2, true);
+	monitor(memory_tracker);
+	combining = gtc->getEnv("combine").empty()? false:stoi(gtc->getEnv("combine"))!=0;
+	task_num = gtc->task_num;
+	scratch = new padded<Arena*>[task_num];
+	pinned = new padded<int64_t>[task_num];
+	for (int i = 0; i < task_num; i++){
+		scratch[i].ui = new (malloc(Arena::bytesFor(SCRATCH_SLOTS))) Arena(SCRATCH_SLOTS);
+		pinned[i].ui = 0;
+	}
+	announce = new padded<Announce>[task_num];
+	combiner_lock.ui.store(false);
 	//initialize with an empty head state.
 	local_tid = 0;
 	curr_state.store(mkState());
@@ -105,10 +124,113 @@ typename BonsaiTree<K, V>::Node* BonsaiTree<K, V>::mkNode(BonsaiTree<K,V>::Node*
 	if (retiredNodeSpot(left) || retiredNodeSpot(right)){
 		return retired_node;
 	}
+	return carveNode(left, right, key, value);
+}
+
+//a full scratch arena fails the attempt, and resetScratch() grows it.
+template<class K, class V>
+typename BonsaiTree<K, V>::Node* BonsaiTree<K, V>::carveNode(
+	BonsaiTree<K, V>::Node* left, BonsaiTree<K, V>::Node* right, K key, V value){
+	Arena* sc = scratch[local_tid].ui;
+	if (sc->used == sc->capacity){
+		return retired_node;
+	}
+	return new (sc->slot(sc->used++)) Node(left, right, key, value);
+}
+
+template<class K, class V>
+typename BonsaiTree<K, V>::Arena* BonsaiTree<K, V>::mkArena(BonsaiTree<K, V>::Node* state, int capacity){
+	Arena* arena = new (malloc(Arena::bytesFor(capacity))) Arena(capacity);
 	void* ptr = memory_tracker->alloc(local_tid);
-	Node* new_node = new (ptr) Node(left, right, key, value);
-	state->state->addNewNode(new_node);
-	return new_node;
+	arena->guard = new (ptr) Node(arena);
+	arena->next = state->state->arena;
+	state->state->arena = arena;
+	pinned[local_tid].ui += Arena::header();
+	return arena;
+}
+
+//must be called before the state is published.
+template<class K, class V>
+void BonsaiTree<K, V>::sealArenas(BonsaiTree<K, V>::Node* state){
+	state->state->root = packScratch(state, state->state->root);
+	for (Arena* arena = state->state->arena; arena != NULL; arena = arena->next){
+		arena->live.store(arena->used, memory_order::memory_order_release);
+	}
+}
+
+/*
+ * Moves the nodes in this thread's scratch arena to new arenas of
+ * state, as few as fit them, and returns where root went. Nodes are
+ * carved after their children, so those have moved already. The
+ * nodes the state replaces may have been carved by it too.
+ */
+template<class K, class V>
+typename BonsaiTree<K, V>::Node* BonsaiTree<K, V>::packScratch(BonsaiTree<K, V>::Node* state, 
+	BonsaiTree<K, V>::Node* root){
+	Arena* sc = scratch[local_tid].ui;
+	int max = Arena::MAX_CAPACITY;
+	std::vector<Arena*> dst;
+	for (int first = 0; first < sc->used; first += max){
+		dst.push_back(mkArena(state, std::min(max, sc->used-first)));
+	}
+	auto moved = [&](Node* node){
+		if (!sc->holds(node)){
+			return node;
+		}
+		int i = node-sc->slot(0);
+		return dst[i/max]->slot(i%max);
+	};
+	for (int i = 0; i < sc->used; i++){
+		Node* node = sc->slot(i);
+		Arena* arena = dst[i/max];
+		Node* to = new (arena->slot(arena->used)) Node(moved(node->left.load()), moved(node->right.load()),
+			std::move(node->key), std::move(node->value));
+		to->index = arena->used++;
+	}
+	for (Node*& node : state->state->retire_list_prev){
+		node = moved(node);
+	}
+	root = moved(root);
+	resetScratch();
+	return root;
+}
+
+//empties this thread's scratch arena, growing it if an attempt
+//filled it up.
+template<class K, class V>
+void BonsaiTree<K, V>::resetScratch(){
+	Arena* sc = scratch[local_tid].ui;
+	for (int i = 0; i < sc->used; i++){
+		sc->slot(i)->~Node();
+	}
+	if (sc->used < sc->capacity){
+		sc->used = 0;
+		return;
+	}
+	int capacity = 2*sc->capacity;
+	free(sc);
+	scratch[local_tid].ui = new (malloc(Arena::bytesFor(capacity))) Arena(capacity);
+}
+
+//sizes this thread's empty scratch arena for a bulk build of n nodes,
+//which cannot retry, with a spare slot so that packing does not grow
+//it; 0 sets it back to the default.
+template<class K, class V>
+void BonsaiTree<K, V>::reserveScratch(size_t n){
+	int capacity = (n == 0)? SCRATCH_SLOTS : n+1;
+	if (scratch[local_tid].ui->capacity != capacity){
+		free(scratch[local_tid].ui);
+		scratch[local_tid].ui = new (malloc(Arena::bytesFor(capacity))) Arena(capacity);
+	}
+}
+
+template<class K, class V>
+uint64_t BonsaiTree<K, V>::pinned_bytes(){
+	int64_t sum = 0;
+	for (int i = 0; i < task_num; i++){
+		sum += pinned[i].ui;
+	}
+	return sum > 0? sum : 0;
 }
 
 template<class K, class V>
@@ -126,20 +248,28 @@ void BonsaiTree<K, V>::retireState(BonsaiTree<K, V>::Node* state, std::list<Bons
 		node = retire_list_prev.back();
 		node->left = retired_node;
 		node->right = retired_node;
-		memory_tracker->retire(node, local_tid);
+		Arena* arena = Arena::of(node);
+		if (arena->live.fetch_sub(1, memory_order::memory_order_acq_rel) == 1){
+			//the tracker counts the whole arena from now on
+			pinned[local_tid].ui -= Arena::header()+(arena->used-1)*sizeof(Node);
+			memory_tracker->retire(arena->guard, local_tid);
+		} else {
+			pinned[local_tid].ui += sizeof(Node);
+		}
 	}
 	memory_tracker->retire(state, local_tid);
 }
 
+//discards a state that was never published, with all its arenas.
 template<class K, class V>
-void BonsaiTree<K, V>::reclaimState(BonsaiTree<K, V>::Node* state, std::list<BonsaiTree<K, V>::Node*>& new_list){
-	Node* node;
-
-	for(; !new_list.empty(); new_list.pop_back()){
-		node = new_list.back();
-		assert(node!=retired_node);
-		assert(node->state==NULL);
-		memory_tracker->reclaim(node, local_tid);
+void BonsaiTree<K, V>::reclaimState(BonsaiTree<K, V>::Node* state){
+	resetScratch();
+	Arena* arena = state->state->arena;
+	while (arena != NULL){
+		Arena* next = arena->next;
+		pinned[local_tid].ui -= Arena::header();
+		memory_tracker->reclaim(arena->guard, local_tid);
+		arena = next;
 	}
 	memory_tracker->reclaim(state, local_tid);
 }
@@ -156,8 +286,8 @@ bool BonsaiTree<K, V>::retiredNodeSpot(BonsaiTree<K, V>::Node* ptr){
 		return true;
 	}
 	if (ptr){
-		if (protect_read(ptr->left) == retired_node ||
-			protect_read(ptr->right) == retired_node){
+		if (protect_read(ptr->left, ptr) == retired_node ||
+			protect_read(ptr->right, ptr) == retired_node){
 			return true;
 		}
 	}
@@ -171,9 +301,27 @@ unsigned long BonsaiTree<K, V>::treeSize(){
 	return nodeSize(curr_state.load()->state->root);
 }
 
-template<class K, class V>
-typename BonsaiTree<K, V>::Node* BonsaiTree<K, V>::protect_read(atomic<BonsaiTree<K, V>::Node*>& node){
-	return memory_tracker->read(node, 0, local_tid, nullptr);
+/*
+ * A state and everything reachable from it were alive at the era
+ * reserved when the state was read into kState, and are retired only
+ * after the state is replaced. So that reservation protects the whole
+ * snapshot under HE and WFE, as long as kState is not overwritten
+ * before the operation ends. Reads below the state go to kNode, with
+ * the node holding the field so that WFE can help the read.
+ * Hazard pointers cannot protect a snapshot this way.
+ */
+template<class K, class V>
+typename BonsaiTree<K, V>::Node* BonsaiTree<K, V>::protect_read(atomic<BonsaiTree<K, V>::Node*>& node, 
+	BonsaiTree<K, V>::Node* parent){
+	//the birth epoch of an arena node is kept by its guard, and
+	//a node still in scratch is private to this thread.
+	if (parent != NULL && parent->state == NULL){
+		if (scratch[local_tid].ui->holds(parent)){
+			return node.load(memory_order::memory_order_acquire);
+		}
+		parent = Arena::of(parent)->guard;
+	}
+	return memory_tracker->read(node, kNode, local_tid, parent);
 }
 
 template<class K, class V>
@@ -181,7 +329,6 @@ optional<V> BonsaiTree<K, V>::update(Operation op, K key, V val, int tid){
 	V* ori_val = NULL;
 	optional<V> nf = {};
 	optional<V> ret;
-	bool ins_ret=false;
 
 	Node* old_state;
 	Node* new_state;
@@ -189,6 +336,9 @@ optional<V> BonsaiTree<K, V>::update(Operation op, K key, V val, int tid){
 
 	local_tid = tid;
 	collect_retired_size(memory_tracker->get_retired_cnt(tid), tid);
+	if (combining){
+		return combine(op, key, val, tid);
+	}
 
 #ifdef LAZY_TRACKER
 	memory_tracker->start_op(tid);
@@ -199,28 +349,12 @@ optional<V> BonsaiTree<K, V>::update(Operation op, K key, V val, int tid){
 #ifndef LAZY_TRACKER
 		memory_tracker->start_op(tid);
 #endif
-		old_state = memory_tracker->read(curr_state, 0, tid, nullptr);
+		old_state = memory_tracker->read(curr_state, kState, tid, nullptr);
 		new_state = mkState();
-		switch(op){
-			case op_put:
-				new_state->state->root = doPut(new_state, protect_read(old_state->state->root), key, val, &ori_val);
-				break;
-			case op_replace:
-				new_state->state->root = doReplace(new_state, protect_read(old_state->state->root), key, val, &ori_val);
-				break;
-			case op_remove:
-				new_state->state->root = doRemove(new_state, protect_read(old_state->state->root), key, &ori_val);
-				break;
-			case op_insert:
-				new_state->state->root = doInsert(new_state, protect_read(old_state->state->root), key, val, &ins_ret);
-				ori_val = (ins_ret)? NULL : new V();
-				break;
-			default:
-				assert(false && "operation type error.");
-		}
+		new_state->state->root = doOp(new_state, protect_read(old_state->state->root, old_state), op, key, val, &ori_val);
 		if (new_state->state->root == retired_node){
 			if (ori_val) delete ori_val;
-			reclaimState(new_state, new_state->state->new_list);
+			reclaimState(new_state);
 #ifndef LAZY_TRACKER
 			memory_tracker->end_op(tid);
 			memory_tracker->clear_all(tid);
@@ -230,6 +364,7 @@ optional<V> BonsaiTree<K, V>::update(Operation op, K key, V val, int tid){
 
 		// memory_tracker->reserve(new_state, 1, tid);
 		
+		sealArenas(new_state);
 		std::list<Node*> retire_list_prev = new_state->state->retire_list_prev;
 		if (curr_state.compare_exchange_strong(old_state, new_state, 
 			memory_order::memory_order_acq_rel, memory_order::memory_order_acquire)){
@@ -240,7 +375,7 @@ optional<V> BonsaiTree<K, V>::update(Operation op, K key, V val, int tid){
 			if (ori_val) delete ori_val;
 			//memory_tracker->template destruct<State>(new_state);
 			// delete new_state;
-			reclaimState(new_state, new_state->state->new_list);
+			reclaimState(new_state);
 
 #ifndef LAZY_TRACKER
 			memory_tracker->end_op(tid);
@@ -258,6 +393,104 @@ optional<V> BonsaiTree<K, V>::update(Operation op, K key, V val, int tid){
 	return ret;
 }
 
+template<class K, class V>
+typename BonsaiTree<K, V>::Node* BonsaiTree<K, V>::doOp(BonsaiTree<K, V>::Node* state, 
+	BonsaiTree<K, V>::Node* root, Operation op, K key, V value, V** ori_val){
+	bool ins_ret=false;
+	switch(op){
+		case op_put:
+			return doPut(state, root, key, value, ori_val);
+		case op_replace:
+			return doReplace(state, root, key, value, ori_val);
+		case op_remove:
+			return doRemove(state, root, key, ori_val);
+		case op_insert:
+			root = doInsert(state, root, key, value, &ins_ret);
+			*ori_val = (ins_ret)? NULL : new V();
+			return root;
+		default:
+			assert(false && "operation type error.");
+			return retired_node;
+	}
+}
+
+/*
+ * Flat combining [Hendler et al., SPAA'10]: the update is announced,
+ * and whoever holds combiner_lock applies every pending announcement
+ * to one new state, so a whole batch costs one path-copying pass and
+ * one swap of curr_state instead of a CAS race that throws away the
+ * losers' copies. Only the combiner swaps the state in this mode, so
+ * it is blocking while a combiner is stalled.
+ */
+template<class K, class V>
+optional<V> BonsaiTree<K, V>::combine(Operation op, K key, V val, int tid){
+	Announce* ann = &announce[tid].ui;
+	ann->op = op;
+	ann->key = key;
+	ann->val = val;
+	ann->status.store(ann_pending, memory_order::memory_order_release);
+	while (ann->status.load(memory_order::memory_order_acquire) != ann_done){
+		bool expected = false;
+		if (!combiner_lock.ui.load(memory_order::memory_order_relaxed) &&
+			combiner_lock.ui.compare_exchange_strong(expected, true, memory_order::memory_order_acquire)){
+			combineBatch(tid);
+			combiner_lock.ui.store(false, memory_order::memory_order_release);
+		}
+	}
+	ann->status.store(ann_empty, memory_order::memory_order_relaxed);
+	return ann->res;
+}
+
+template<class K, class V>
+void BonsaiTree<K, V>::combineBatch(int tid){
+	std::vector<int> batch;
+	std::vector<V*> ori_vals;
+
+	while(true){
+		memory_tracker->start_op(tid);
+		Node* old_state = memory_tracker->read(curr_state, kState, tid, nullptr);
+		Node* new_state = mkState();
+		Node* root = protect_read(old_state->state->root, old_state);
+		for (int i = 0; i < task_num && root != retired_node; i++){
+			Announce* ann = &announce[i].ui;
+			if (ann->status.load(memory_order::memory_order_acquire) != ann_pending){
+				continue;
+			}
+			V* ori_val = NULL;
+			root = doOp(new_state, root, ann->op, ann->key, ann->val, &ori_val);
+			batch.push_back(i);
+			ori_vals.push_back(ori_val);
+		}
+		new_state->state->root = root;
+
+		if (root != retired_node){
+			sealArenas(new_state);
+			std::list<Node*> retire_list_prev = new_state->state->retire_list_prev;
+			if (curr_state.compare_exchange_strong(old_state, new_state, 
+				memory_order::memory_order_acq_rel, memory_order::memory_order_acquire)){
+				retireState(old_state, retire_list_prev);
+				for (size_t j = 0; j < batch.size(); j++){
+					Announce* ann = &announce[batch[j]].ui;
+					ann->res = (ori_vals[j])? optional<V>(*ori_vals[j]) : optional<V>();
+					if (ori_vals[j]) delete ori_vals[j];
+					ann->status.store(ann_done, memory_order::memory_order_release);
+				}
+				memory_tracker->end_op(tid);
+				memory_tracker->clear_all(tid);
+				return;
+			}
+		}
+		for (size_t j = 0; j < ori_vals.size(); j++){
+			if (ori_vals[j]) delete ori_vals[j];
+		}
+		batch.clear();
+		ori_vals.clear();
+		reclaimState(new_state);
+		memory_tracker->end_op(tid);
+		memory_tracker->clear_all(tid);
+	}
+}
+
 template<class K, class V>
 bool BonsaiTree<K, V>::insert(K key, V val, int tid){
 	return (!update(op_insert, key, val, tid));
@@ -281,18 +514,20 @@ optional<V> BonsaiTree<K, V>::remove(K key,int tid){
 template<class K, class V>
 optional<V> BonsaiTree<K, V>::get(K key, int tid){//TODO: new version needed.
 	V ret;
+	local_tid = tid;
 	collect_retired_size(memory_tracker->get_retired_cnt(tid), tid);
 	memory_tracker->start_op(tid);
 	while(true){
-		BonsaiTree<K, V>::Node* node = protect_read(protect_read(curr_state)->state->root);
+		BonsaiTree<K, V>::Node* state = memory_tracker->read(curr_state, kState, tid, nullptr);
+		BonsaiTree<K, V>::Node* node = protect_read(state->state->root, state);
 
 		while (node && node != retired_node){
 			if (node->key == key){
 				break;
 			} else if (key < node->key){
-				node = protect_read(node->left);
+				node = protect_read(node->left, node);
 			} else {
-				node = protect_read(node->right);
+				node = protect_read(node->right, node);
 			}
 		}
 		if (retiredNodeSpot(node)){
@@ -311,15 +546,104 @@ optional<V> BonsaiTree<K, V>::get(K key, int tid){//TODO: new version needed.
 	}
 }
 
+//builds a perfectly balanced subtree; the nodes of a forked half go
+//to the helper's own state first, since arenas are not shared.
+//The caller has reserved scratch room for n nodes.
+template<class K, class V>
+typename BonsaiTree<K, V>::Node* BonsaiTree<K, V>::build(BonsaiTree<K, V>::Node* state, 
+	const K* keys, const V* vals, size_t n, int tid, int nthreads){
+	if (n == 0){
+		return NULL;
+	}
+	size_t mid = n/2;
+	Node* left = NULL;
+	Node* right = NULL;
+	if (nthreads > 1){
+		int half = nthreads/2;
+		Node* helper_state = NULL;
+		std::thread helper([&]{
+			local_tid = tid+half;
+			helper_state = mkState();
+			reserveScratch(mid);
+			left = packScratch(helper_state, build(helper_state, keys, vals, mid, tid+half, nthreads-half));
+			reserveScratch(0);
+		});
+		right = build(state, keys+mid+1, vals+mid+1, n-mid-1, tid, half);
+		helper.join();
+		adoptArenas(state, helper_state);
+	} else {
+		left = build(state, keys, vals, mid, tid, 1);
+		right = build(state, keys+mid+1, vals+mid+1, n-mid-1, tid, 1);
+	}
+	Node* node = carveNode(left, right, keys[mid], vals[mid]);
+	assert(node != retired_node);
+	return node;
+}
+
+//moves the arenas of an unpublished state to state, and frees it.
+template<class K, class V>
+void BonsaiTree<K, V>::adoptArenas(BonsaiTree<K, V>::Node* state, BonsaiTree<K, V>::Node* from){
+	Arena* tail = from->state->arena;
+	if (tail != NULL){
+		while (tail->next != NULL){
+			tail = tail->next;
+		}
+		tail->next = state->state->arena;
+		state->state->arena = from->state->arena;
+		from->state->arena = NULL;
+	}
+	memory_tracker->reclaim(from, local_tid);
+}
+
+template<class K, class V>
+void BonsaiTree<K, V>::bulkLoad(const K* keys, const V* vals, size_t n, int nthreads){
+	Node* old_state = curr_state.load();
+	if (old_state->state->root.load() != NULL){
+		ROrderedMap<K, V>::bulkLoad(keys, vals, n, nthreads);
+		return;
+	}
+	local_tid = 0;
+	Node* new_state = mkState();
+	reserveScratch(n);
+	new_state->state->root = build(new_state, keys, vals, n, 0, nthreads);
+	std::list<Node*> retire_list_prev;
+	sealArenas(new_state);
+	reserveScratch(0);
+	curr_state.store(new_state);
+	retireState(old_state, retire_list_prev);
+}
+
 template<class K, class V>
 map<K, V> BonsaiTree<K,V>::rangeQuery(K key1, K key2, int& len, int tid){
-	map<K, V> ret;
+	RangeCollector<K,V> collector;
+	len = rangeScan(key1, key2, &collector, tid);
+	return collector.res;
+}
+
+/*
+ * In-order walk of the current state. A retired_node link means the
+ * snapshot is being retired under us; the walk then restarts from the
+ * newest state and skips every key up to the last one visited, so each
+ * key is reported once and in order.
+ */
+template<class K, class V>
+int BonsaiTree<K,V>::rangeScan(K key1, K key2, RangeVisitor<K,V>* visitor, int tid){
+	if (key1 > key2) return 0;
+	local_tid = tid;
+	collect_retired_size(memory_tracker->get_retired_cnt(tid), tid);
 	memory_tracker->start_op(tid);
-	BonsaiTree<K, V>::Node* root = curr_state.load()->state->root;
-	doRangeQuery(root, key1, key2, &ret);
+	int cnt = 0;
+	bool exclusive = false;
+	while(true){
+		BonsaiTree<K, V>::Node* state = memory_tracker->read(curr_state, kState, tid, nullptr);
+		BonsaiTree<K, V>::Node* root = protect_read(state->state->root, state);
+		if (doRangeScan(root, key1, key2, exclusive, visitor, cnt)){
+			break;
+		}
+	}
 	memory_tracker->clear_all(tid);
 	memory_tracker->end_op(tid);
-	return ret;
+	return cnt;
 }
 
 template<class K, class V>
@@ -336,11 +660,11 @@ typename BonsaiTree<K, V>::Node* BonsaiTree<K, V>::doInsert(BonsaiTree<K, V>::No
 		*ret = false; //return false, insert failed.
 		return node;
 	} else if (key < node->key){
-		return mkBalanced(state, node, doInsert(state, protect_read(node->left), key, value, ret),
-			protect_read(node->right));
+		return mkBalanced(state, node, doInsert(state, protect_read(node->left, node), key, value, ret),
+			protect_read(node->right, node));
 	} else {//if (key > node->key){
-		return mkBalanced(state, node, protect_read(node->left), 
-			doInsert(state, protect_read(node->right), key, value, ret));
+		return mkBalanced(state, node, protect_read(node->left, node), 
+			doInsert(state, protect_read(node->right, node), key, value, ret));
 	}
 }
 
@@ -357,13 +681,13 @@ typename BonsaiTree<K, V>::Node* BonsaiTree<K, V>::doPut(BonsaiTree<K, V>::Node*
 	if (key == node->key){
 		*ori_val = new V(node->value);
 		retireNode(state, node);
-		return mkNode(state, protect_read(node->left), protect_read(node->right), key, value);
+		return mkNode(state, protect_read(node->left, node), protect_read(node->right, node), key, value);
 	} else if (key < node->key){
-		return mkBalanced(state, node, doPut(state, protect_read(node->left), key, value, ori_val),
-			protect_read(node->right));
+		return mkBalanced(state, node, doPut(state, protect_read(node->left, node), key, value, ori_val),
+			protect_read(node->right, node));
 	} else {//if (key > node->key){
-		return mkBalanced(state, node, protect_read(node->left), 
-			doPut(state, protect_read(node->right), key, value, ori_val));
+		return mkBalanced(state, node, protect_read(node->left, node), 
+			doPut(state, protect_read(node->right, node), key, value, ori_val));
 	}	
 }
 
@@ -380,13 +704,13 @@ typename BonsaiTree<K, V>::Node* BonsaiTree<K, V>::doReplace(BonsaiTree<K, V>::N
 	if (key == node->key){
 		*ori_val = new V(node->value);
 		retireNode(state, node);
-		return mkNode(state, protect_read(node->left), protect_read(node->right), key, value);
+		return mkNode(state, protect_read(node->left, node), protect_read(node->right, node), key, value);
 	} else if (key < node->key){
-		return mkBalanced(state, node, doReplace(state, protect_read(node->left), key, value, ori_val),
-			protect_read(node->right));
+		return mkBalanced(state, node, doReplace(state, protect_read(node->left, node), key, value, ori_val),
+			protect_read(node->right, node));
 	} else {//if (key > node->key){
-		return mkBalanced(state, node, protect_read(node->left), 
-			doReplace(state, protect_read(node->right), key, value, ori_val));
+		return mkBalanced(state, node, protect_read(node->left, node), 
+			doReplace(state, protect_read(node->right, node), key, value, ori_val));
 	}
 }
 
@@ -409,21 +733,21 @@ typename BonsaiTree<K, V>::Node* BonsaiTree<K, V>::doRemove(BonsaiTree<K, V>::No
 			retireNode(state, node);
 			BonsaiTree<K, V>::Node* successor = NULL;
 			if (node->left) {
-				BonsaiTree<K, V>::Node* new_left = pullRightMost(state, protect_read(node->left), &successor);
+				BonsaiTree<K, V>::Node* new_left = pullRightMost(state, protect_read(node->left, node), &successor);
 				assert(successor!=NULL);
-				return mkBalanced(state, successor, new_left, protect_read(node->right));
+				return mkBalanced(state, successor, new_left, protect_read(node->right, node));
 			} else {//if (node->right) {
-				BonsaiTree<K, V>::Node* new_right = pullLeftMost(state, protect_read(node->right), &successor);
+				BonsaiTree<K, V>::Node* new_right = pullLeftMost(state, protect_read(node->right, node), &successor);
 				assert(successor!=NULL);
-				return mkBalanced(state, successor, protect_read(node->left), new_right);
+				return mkBalanced(state, successor, protect_read(node->left, node), new_right);
 			} 
 		}
 	} else if (key < node->key){
-		return mkBalanced(state, node, doRemove(state, protect_read(node->left), key, ori_val),
-			protect_read(node->right));
+		return mkBalanced(state, node, doRemove(state, protect_read(node->left, node), key, ori_val),
+			protect_read(node->right, node));
 	} else {//if (key > node->key){
-		return mkBalanced(state, node, protect_read(node->left), 
-			doRemove(state, protect_read(node->right), key, ori_val));
+		return mkBalanced(state, node, protect_read(node->left, node), 
+			doRemove(state, protect_read(node->right, node), key, ori_val));
 	}
 }
 
@@ -435,11 +759,11 @@ typename BonsaiTree<K, V>::Node* BonsaiTree<K, V>::pullLeftMost(BonsaiTree<K, V>
 		return retired_node;
 	}
 	if (node->left){
-		return mkBalanced(state, node, pullLeftMost(state, protect_read(node->left), successor), protect_read(node->right));
+		return mkBalanced(state, node, pullLeftMost(state, protect_read(node->left, node), successor), protect_read(node->right, node));
 	} else {//node is the leftmost node.
 		*successor = mkNode(state, NULL, NULL, node->key, node->value);
 		retireNode(state, node);
-		return protect_read(node->right); 
+		return protect_read(node->right, node); 
 	}
 }
 
@@ -451,11 +775,11 @@ typename BonsaiTree<K, V>::Node* BonsaiTree<K, V>::pullRightMost(BonsaiTree<K, V
 		return retired_node;
 	}
 	if (node->right){
-		return mkBalanced(state, node, protect_read(node->left), pullRightMost(state, protect_read(node->right), successor));
+		return mkBalanced(state, node, protect_read(node->left, node), pullRightMost(state, protect_read(node->right, node), successor));
 	} else {//node is the rightmost node.
 		*successor = mkNode(state, NULL, NULL, node->key, node->value);
 		retireNode(state, node);
-		return protect_read(node->left);
+		return protect_read(node->left, node);
 	}
 }
 
@@ -490,8 +814,8 @@ typename BonsaiTree<K, V>::Node* BonsaiTree<K, V>::mkBalancedL(BonsaiTree<K, V>:
 	BonsaiTree<K, V>::Node* left, BonsaiTree<K, V>::Node* right, K key, V value){
 	assert(right!=NULL);
 	BonsaiTree<K, V>::Node* out;
-	Node* right_left = protect_read(right->left);
-	Node* right_right = protect_read(right->right);
+	Node* right_left = protect_read(right->left, right);
+	Node* right_right = protect_read(right->right, right);
 	if (retiredNodeSpot(right_left) || retiredNodeSpot(right_right)){
 		return retired_node;
 	}
@@ -506,8 +830,8 @@ template<class K, class V>
 typename BonsaiTree<K, V>::Node* BonsaiTree<K, V>::mkBalancedR(BonsaiTree<K, V>::Node* state, 
 	BonsaiTree<K, V>::Node* left, BonsaiTree<K, V>::Node* right, K key, V value){
 	assert(left!=NULL);
-	Node* left_right = protect_read(left->right);
-	Node* left_left = protect_read(left->left);
+	Node* left_right = protect_read(left->right, left);
+	Node* left_left = protect_read(left->left, left);
 	if (retiredNodeSpot(left_right) || retiredNodeSpot(left_left)){
 		return retired_node;
 	}
@@ -535,8 +859,8 @@ typename BonsaiTree<K, V>::Node* BonsaiTree<K, V>::doubleL(BonsaiTree<K, V>::Nod
 	BonsaiTree<K, V>::Node* right_left, BonsaiTree<K, V>::Node* right_right, K key, V value){
 	
 	BonsaiTree<K, V>::Node* out = mkNode(state, 
-		mkNode(state, left, protect_read(right_left->left), key, value),
-		mkNode(state, protect_read(right_left->right), right_right, right->key, right->value),
+		mkNode(state, left, protect_read(right_left->left, right_left), key, value),
+		mkNode(state, protect_read(right_left->right, right_left), right_right, right->key, right->value),
 		right_left->key, right_left->value);
 	retireNode(state, right_left);
 	retireNode(state, right);
@@ -560,8 +884,8 @@ typename BonsaiTree<K, V>::Node* BonsaiTree<K, V>::doubleR(BonsaiTree<K, V>::Nod
 	BonsaiTree<K, V>::Node* left_right, BonsaiTree<K, V>::Node* left_left, K key, V value){
 	
 	BonsaiTree<K, V>::Node* out = mkNode(state, 
-		mkNode(state, left_left, protect_read(left_right->left), left->key, left->value),
-		mkNode(state, protect_read(left_right->right), right, key, value),
+		mkNode(state, left_left, protect_read(left_right->left, left_right), left->key, left->value),
+		mkNode(state, protect_read(left_right->right, left_right), right, key, value),
 		left_right->key, left_right->value);
 
 	assert(left_right!=left);
@@ -571,17 +895,31 @@ typename BonsaiTree<K, V>::Node* BonsaiTree<K, V>::doubleR(BonsaiTree<K, V>::Nod
 }
 
 template<class K, class V>
-void BonsaiTree<K,V>::doRangeQuery(Node* node, K key1, K key2, std::map<K, V>* ret){
-	// TODO: test this.
-	// if (node->value > key1 && node->left){
-	// 	doRangeQuery(node->left, key1, key2, ret);
-	// }
-	// if (node->value >= key1 && node->value <= key2){
-	// 	ret->emplace(node->key, node->value);
-	// }
-	// if (node->value < key2 && node->right){
-	// 	doRangeQuery(node->right, key1, key2, ret);
-	// }
+bool BonsaiTree<K,V>::doRangeScan(Node* node, K& lo, K& hi, bool& exclusive, RangeVisitor<K,V>* visitor, int& cnt){
+	//lo is raised to each visited key, so a restart resumes after it.
+	if (!node){
+		return true;
+	}
+	if (node == retired_node){
+		return false;
+	}
+	if (lo < node->key){
+		if (!doRangeScan(protect_read(node->left, node), lo, hi, exclusive, visitor, cnt)){
+			return false;
+		}
+	}
+	if ((lo < node->key || (!exclusive && node->key == lo)) && !(hi < node->key)){
+		visitor->visit(node->key, node->value);
+		cnt++;
+		lo = node->key;
+		exclusive = true;
+	}
+	if (node->key < hi){
+		if (!doRangeScan(protect_read(node->right, node), lo, hi, exclusive, visitor, cnt)){
+			return false;
+		}
+	}
+	return true;
 }
 
 template class BonsaiTree<std::string, std::string>;
@@ -25,6 +25,7 @@ limitations under the License.
 #include <string>
 #include <list>
 #include "Harness.hpp"
+#include "ConcurrentPrimitives.hpp"
 #include "ROrderedMap.hpp"
 #include "MemoryTracker.hpp"
 #include "RetiredMonitorable.hpp"
@@ -37,6 +38,7 @@ template <class K, class V> class BonsaiTree : public ROrderedMap<K, V>, public
 private:
 
 	class State;
+	class Arena;
 
 	class Node{
 	public:
@@ -45,19 +47,60 @@ private:
 		std::atomic<Node*> right;
 		K key;
 		V value;
-		unsigned long size;
-		//or a wrapper to a State node.
+		unsigned int size;
+		unsigned int index;//of its slot in the arena
+		//or a wrapper to a State node,
 		State* state = NULL;
-		Node* next_state = NULL;
+		//or the guard node that frees an arena.
+		Arena* guarded = NULL;
 
 		inline bool deletable() {return true;}
+		//bytes the destructor frees besides the node itself
+		inline size_t retiredBytes() {
+			return (state? sizeof(State):0) + (guarded? guarded->bytes():0);
+		}
 		Node();
 
 		Node(Node* l, Node* r, K k, V v);
 		Node(State* state);
+		Node(Arena* arena);
 		~Node();
 	};
 
+	/*
+	 * Storage for the nodes built by one state. A tree node is never
+	 * freed on its own: the arena counts its nodes that are still in
+	 * the tree, and when the last one is replaced its guard node is
+	 * retired instead. The guard is allocated before any node of the
+	 * arena is published and retired after all of them, so a
+	 * reservation that covers one of those nodes also covers the
+	 * guard, whose destructor frees the whole arena.
+	 *
+	 * A node finds its arena from the index of its slot, and keeps no
+	 * pointer to it. A state carves its nodes from the thread's
+	 * scratch arena first, and sealArenas() moves them to arenas of
+	 * just the size used, up to MAX_CAPACITY nodes each: the bottom of
+	 * a copied path outlives its top, and small arenas let the top go.
+	 */
+	class Arena{
+	public:
+		static const int MAX_CAPACITY = 8;
+		Arena* next;//older arena of the same state
+		Node* guard;
+		int capacity;
+		int used;
+		std::atomic<int> live;
+
+		Arena(int capacity):next(NULL), guard(NULL), capacity(capacity), used(0), live(0){}
+		//the slots follow the header, aligned for a Node
+		static size_t header(){return (sizeof(Arena)+alignof(Node)-1)/alignof(Node)*alignof(Node);}
+		static size_t bytesFor(int capacity){return header()+capacity*sizeof(Node);}
+		static Arena* of(Node* node){return (Arena*)((char*)(node-node->index)-header());}
+		size_t bytes(){return bytesFor(capacity);}
+		Node* slot(int i){return reinterpret_cast<Node*>((char*)this+header())+i;}
+		bool holds(Node* node){return node>=slot(0) && node<slot(capacity);}
+	};
+
 
 
 	class State{
@@ -68,26 +111,39 @@ private:
 		std::atomic<Node*> root;
 		Node* next;
 		std::list<Node*> retire_list_prev;
-		std::list<Node*> retire_list;
-		std::list<Node*> new_list;
+		Arena* arena;//newest arena of the nodes built for this state
 
 		MemoryTracker<Node>* memory_tracker;
 
 		State(MemoryTracker<Node>* memory_tracker);
 		State(Node* r, Node* n);
 		~State();
-		void addNewNode(Node* new_node);
 	};
 
 	enum Operation { op_insert, op_put, op_replace, op_remove };
 
+	//flat combining: an update announced by a thread, applied by the combiner.
+	enum AnnounceStatus { ann_empty, ann_pending, ann_done };
+	class Announce{
+	public:
+		std::atomic<int> status;
+		Operation op;
+		K key;
+		V val;
+		optional<V> res;
+		Announce():status(ann_empty){}
+	};
+
 	
 	std::atomic<Node*> curr_state;	
 
 	static __thread int local_tid;
 
-	Node* protect_read(std::atomic<Node*>& read);
+	Node* protect_read(std::atomic<Node*>& read, Node* parent);
 	optional<V> update(Operation op, K key, V val, int tid);
+	optional<V> combine(Operation op, K key, V val, int tid);
+	void combineBatch(int tid);
+	Node* doOp(Node* state, Node* root, Operation op, K key, V value, V** ori_val);
 	Node* doInsert(Node* state, Node* root, K key, V value, bool* ret);
 	Node* doPut(Node* state, Node* root, K key, V value, V** ori_val);
 	Node* doReplace(Node* state, Node* root, K key, V value, V** ori_val);
@@ -95,9 +151,15 @@ private:
 
 	Node* mkState();
 	void killNewState(Node* state);
+	Arena* mkArena(Node* state, int capacity);
+	void sealArenas(Node* state);
+	Node* packScratch(Node* state, Node* root);
+	void resetScratch();
+	void reserveScratch(size_t n);
 	
 	Node* mkNode(State* state);
 	Node* mkNode(Node* state, Node* left, Node* right, K key, V value);
+	Node* carveNode(Node* left, Node* right, K key, V value);
 	unsigned long nodeSize(Node* node);
 
 	//routines for balancing
@@ -113,16 +175,35 @@ private:
 	Node* pullLeftMost(Node* state, Node* node, Node** successor);
 	Node* pullRightMost(Node* state, Node* node, Node** successor);
 
-	//routine for rangeQuery
-	void doRangeQuery(Node* node, K key1, K key2, std::map<K, V>* ret);
+	//routines for bulkLoad
+	Node* build(Node* state, const K* keys, const V* vals, size_t n, int tid, int nthreads);
+	void adoptArenas(Node* state, Node* from);
+
+	//routine for rangeScan
+	bool doRangeScan(Node* node, K& lo, K& hi, bool& exclusive, RangeVisitor<K,V>* visitor, int& cnt);
 
 	//garbage collection:
 	void retireNode(Node* state, Node* node);
 	void retireState(Node* state, std::list<Node*>& retire_list_prev);
-	void reclaimState(Node* state, std::list<Node*>& new_list);
+	void reclaimState(Node* state);
 
 	//memory tracker:
 	MemoryTracker<Node>* memory_tracker;
+	const int kState = 0;
+	const int kNode = 1;
+
+	//per-thread scratch arenas, see Arena:
+	static const int SCRATCH_SLOTS = 64;
+	padded<Arena*>* scratch;
+	//bytes of arena headers and of replaced nodes in arenas still in
+	//use, counted by the thread that allocates or retires them:
+	padded<int64_t>* pinned;
+
+	//flat combining, enabled with -d combine=1:
+	bool combining;
+	int task_num;
+	padded<Announce>* announce;
+	paddedAtomic<bool> combiner_lock;
 	
 	//retired node:
 	static Node* retired_node;
@@ -141,6 +222,9 @@ public:
 	optional<V> remove(K key, int tid);
 	optional<V> replace(K key, V val, int tid);
 	std::map<K, V> rangeQuery(K key1, K key2, int& len, int tid);
+	int rangeScan(K key1, K key2, RangeVisitor<K,V>* visitor, int tid);
+	void bulkLoad(const K* keys, const V* vals, size_t n, int nthreads);
+	uint64_t pinned_bytes();
 };
 
 
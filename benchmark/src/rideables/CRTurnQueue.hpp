@@ -165,6 +165,7 @@ public:
         int emptyf = gtc->getEnv("emptyf").empty()? 30:stoi(gtc->getEnv("emptyf"));
         std::cout<<"emptyf:"<<emptyf<<std::endl;
         memory_tracker = new MemoryTracker<Node>(gtc, epochf, emptyf, 3, COLLECT);
+        monitor(memory_tracker);
         memory_tracker->start_op(0);
         sentinelNode = mkNode(0);
         head.store(sentinelNode, std::memory_order_relaxed);
@@ -0,0 +1,257 @@
+/*
+
+Copyright 2017 University of Rochester
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*/
+
+
+#ifndef LLX_SCX_HPP
+#define LLX_SCX_HPP
+
+#include <atomic>
+#include <algorithm>
+#include "Harness.hpp"
+#include "ConcurrentPrimitives.hpp"
+#include "MemoryTracker.hpp"
+
+/*
+ * LLX/SCX primitives of Brown, Ellen and Ruppert [PODC'13], used to
+ * build non-blocking trees with the tree update template [PPoPP'14].
+ *
+ * SCX records are "weak descriptors" [Brown, PODC'17]: every thread
+ * owns one record that is reused for all its SCXs, and a node's info
+ * field holds a (seq, tid) tag instead of a record pointer. A stale
+ * tag is recognized by its sequence number, so records are never
+ * retired and only tree nodes go through the MemoryTracker.
+ *
+ * Node must provide:
+ *	std::atomic<Node*> child[]; (mutable fields, copied by llx())
+ *	std::atomic<uint64_t> info; (initially 0)
+ *	std::atomic<bool> marked; (initially false)
+ *
+ * A helper reserves every node of the SCX it helps in slots
+ * [help_slot, help_slot+MAX_NODES) before touching them, so the
+ * primitives are safe under HP-like trackers as long as the caller
+ * holds reservations on the nodes it passes to llx() and scx().
+ */
+template <class Node, int MAX_NODES>
+class LLXSCX{
+private:
+	static const uint64_t STATE_INPROGRESS = 0;
+	static const uint64_t STATE_COMMITTED = 1;
+	static const uint64_t STATE_ABORTED = 2;
+	static const uint64_t STATE_MASK = 3;
+	static const uint64_t ALL_FROZEN = 4;
+	static const int SEQ_SHIFT = 3;
+	static const int TAG_TID_BITS = 16;
+
+	struct SCXRecord{
+		// seq<<SEQ_SHIFT | ALL_FROZEN | state
+		std::atomic<uint64_t> mutables;
+		std::atomic<int> num_nodes;
+		std::atomic<uint32_t> finalize_mask;
+		std::atomic<Node*> nodes[MAX_NODES];
+		std::atomic<uint64_t> info_fields[MAX_NODES];
+		std::atomic<std::atomic<Node*>*> field;
+		std::atomic<Node*> old_node;
+		std::atomic<Node*> new_node;
+	};
+
+	MemoryTracker<Node>* memory_tracker;
+	int help_slot;
+	padded<SCXRecord>* records;
+
+	inline uint64_t makeTag(uint64_t seq, int tid){
+		return (seq<<TAG_TID_BITS) | (uint64_t)tid;
+	}
+	inline int tagTid(uint64_t tag){
+		return (int)(tag & ((1ULL<<TAG_TID_BITS)-1));
+	}
+	inline uint64_t tagSeq(uint64_t tag){
+		return tag>>TAG_TID_BITS;
+	}
+	inline uint64_t getSeq(uint64_t mutables){
+		return mutables>>SEQ_SHIFT;
+	}
+
+	// state of the SCX that wrote tag; a finished SCX whose record
+	// has been reused looks committed, which is what llx() needs.
+	uint64_t getState(uint64_t tag){
+		if(tag==0) return STATE_COMMITTED;
+		uint64_t m = records[tagTid(tag)].ui.mutables.load(std::memory_order_acquire);
+		if(getSeq(m)!=tagSeq(tag)) return STATE_COMMITTED;
+		return m & STATE_MASK;
+	}
+
+	bool helpCore(SCXRecord* rec, uint64_t tag, int n, Node** nodes, uint64_t* infos,
+		uint32_t mask, std::atomic<Node*>* field, Node* old_node, Node* new_node);
+	void help(uint64_t tag, int tid);
+
+public:
+	enum LLXResult {LLX_FAIL, LLX_FINALIZED, LLX_SNAPSHOT};
+
+	LLXSCX(GlobalTestConfig* gtc, MemoryTracker<Node>* memory_tracker, int help_slot):
+		memory_tracker(memory_tracker), help_slot(help_slot){
+		if(gtc->task_num >= (1<<TAG_TID_BITS)){
+			errexit("LLXSCX: too many threads for the info tag.");
+		}
+		records = new padded<SCXRecord>[gtc->task_num];
+		for(int i=0;i<gtc->task_num;i++){
+			records[i].ui.mutables.store(STATE_COMMITTED, std::memory_order_relaxed);
+		}
+	}
+	~LLXSCX(){
+		delete[] records;
+	}
+
+	/*
+	 * Copies the first n child pointers of r into snapshot and the
+	 * info value to pass to scx() into info. r must be reserved.
+	 */
+	LLXResult llx(Node* r, Node** snapshot, int n, uint64_t* info, int tid);
+
+	/*
+	 * Atomically replaces old_node with new_node in field (a child
+	 * field of nodes[0]) and finalizes the nodes selected by mask,
+	 * provided none of nodes[0..n) changed since their llx().
+	 * The parent of every node must come before it in nodes, and
+	 * old_node must be one of the finalized nodes.
+	 */
+	bool scx(Node** nodes, uint64_t* infos, int n, uint32_t mask,
+		std::atomic<Node*>* field, Node* old_node, Node* new_node, int tid);
+};
+
+//-------Definition----------
+template <class Node, int MAX_NODES>
+typename LLXSCX<Node,MAX_NODES>::LLXResult LLXSCX<Node,MAX_NODES>::llx(Node* r, Node** snapshot, int n, uint64_t* info, int tid){
+	bool marked1 = r->marked.load(std::memory_order_acquire);
+	uint64_t rinfo = r->info.load(std::memory_order_acquire);
+	uint64_t state = getState(rinfo);
+	bool marked2 = r->marked.load(std::memory_order_acquire);
+	if(state==STATE_ABORTED || (state==STATE_COMMITTED && !marked2)){
+		for(int i=0;i<n;i++){
+			snapshot[i]=r->child[i].load(std::memory_order_acquire);
+		}
+		if(r->info.load(std::memory_order_acquire)==rinfo){
+			*info=rinfo;
+			return LLX_SNAPSHOT;
+		}
+	}
+	rinfo = r->info.load(std::memory_order_acquire);
+	if(getState(rinfo)==STATE_INPROGRESS){
+		help(rinfo,tid);
+	}
+	return marked1? LLX_FINALIZED : LLX_FAIL;
+}
+
+template <class Node, int MAX_NODES>
+bool LLXSCX<Node,MAX_NODES>::scx(Node** nodes, uint64_t* infos, int n, uint32_t mask,
+	std::atomic<Node*>* field, Node* old_node, Node* new_node, int tid){
+	SCXRecord* rec = &(records[tid].ui);
+	uint64_t seq = getSeq(rec->mutables.load(std::memory_order_relaxed))+1;
+	// new seq first: helpers still copying the previous SCX will notice
+	rec->mutables.store(seq<<SEQ_SHIFT | STATE_INPROGRESS, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+	rec->num_nodes.store(n, std::memory_order_relaxed);
+	rec->finalize_mask.store(mask, std::memory_order_relaxed);
+	for(int i=0;i<n;i++){
+		rec->nodes[i].store(nodes[i], std::memory_order_relaxed);
+		rec->info_fields[i].store(infos[i], std::memory_order_relaxed);
+	}
+	rec->field.store(field, std::memory_order_relaxed);
+	rec->old_node.store(old_node, std::memory_order_relaxed);
+	rec->new_node.store(new_node, std::memory_order_relaxed);
+	// the first freezing CAS publishes the record
+	return helpCore(rec,makeTag(seq,tid),n,nodes,infos,mask,field,old_node,new_node);
+}
+
+template <class Node, int MAX_NODES>
+void LLXSCX<Node,MAX_NODES>::help(uint64_t tag, int tid){
+	SCXRecord* rec = &(records[tagTid(tag)].ui);
+	uint64_t seq = tagSeq(tag);
+	uint64_t m = rec->mutables.load(std::memory_order_acquire);
+	if(getSeq(m)!=seq || (m & STATE_MASK)!=STATE_INPROGRESS) return;
+
+	// copy the record, then make sure it was not reused meanwhile
+	Node* nodes[MAX_NODES];
+	uint64_t infos[MAX_NODES];
+	int n = std::min(rec->num_nodes.load(std::memory_order_relaxed), MAX_NODES);
+	uint32_t mask = rec->finalize_mask.load(std::memory_order_relaxed);
+	for(int i=0;i<n;i++){
+		nodes[i] = rec->nodes[i].load(std::memory_order_relaxed);
+		infos[i] = rec->info_fields[i].load(std::memory_order_relaxed);
+	}
+	std::atomic<Node*>* field = rec->field.load(std::memory_order_relaxed);
+	Node* old_node = rec->old_node.load(std::memory_order_relaxed);
+	Node* new_node = rec->new_node.load(std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_acquire);
+	if(getSeq(rec->mutables.load(std::memory_order_relaxed))!=seq) return;
+
+	/*
+	 * Reserve the nodes, then check the SCX is still in progress.
+	 * While it is, every node up to the first one that fails to
+	 * freeze is frozen or the child of a frozen node, so it is still
+	 * in the tree and cannot be freed under our reservations. Nodes
+	 * after that one are never touched.
+	 */
+	for(int i=0;i<n;i++){
+		memory_tracker->reserve_slot(nodes[i],help_slot+i,tid,nullptr);
+	}
+	m = rec->mutables.load(std::memory_order_seq_cst);
+	if(getSeq(m)!=seq || (m & STATE_MASK)!=STATE_INPROGRESS) return;
+
+	helpCore(rec,tag,n,nodes,infos,mask,field,old_node,new_node);
+}
+
+template <class Node, int MAX_NODES>
+bool LLXSCX<Node,MAX_NODES>::helpCore(SCXRecord* rec, uint64_t tag, int n, Node** nodes, uint64_t* infos,
+	uint32_t mask, std::atomic<Node*>* field, Node* old_node, Node* new_node){
+	uint64_t seq = tagSeq(tag);
+	uint64_t in_progress = seq<<SEQ_SHIFT | STATE_INPROGRESS;
+
+	/* freeze all nodes */
+	for(int i=0;i<n;i++){
+		uint64_t expected = infos[i];
+		if(!nodes[i]->info.compare_exchange_strong(expected,tag,std::memory_order_acq_rel)
+			&& expected!=tag){
+			uint64_t m = rec->mutables.load(std::memory_order_acquire);
+			if(getSeq(m)!=seq) return true;// only helpers get here; the owner is done
+			if(m & ALL_FROZEN) return true;// already finished by someone else
+			if(rec->mutables.compare_exchange_strong(in_progress,
+				seq<<SEQ_SHIFT | STATE_ABORTED, std::memory_order_acq_rel)){
+				return false;
+			}
+			return (in_progress & ALL_FROZEN)!=0;
+		}
+	}
+	uint64_t m = in_progress;
+	if(!rec->mutables.compare_exchange_strong(m, in_progress | ALL_FROZEN, std::memory_order_acq_rel)){
+		if(getSeq(m)!=seq) return true;
+		if((m & STATE_MASK)==STATE_ABORTED) return false;
+	}
+
+	/* finalize, update, commit */
+	for(int i=0;i<n;i++){
+		if(mask & (1u<<i)){
+			nodes[i]->marked.store(true, std::memory_order_release);
+		}
+	}
+	field->compare_exchange_strong(old_node,new_node,std::memory_order_acq_rel);
+	m = in_progress | ALL_FROZEN;
+	rec->mutables.compare_exchange_strong(m, seq<<SEQ_SHIFT | ALL_FROZEN | STATE_COMMITTED, std::memory_order_acq_rel);
+	return true;
+}
+
+#endif
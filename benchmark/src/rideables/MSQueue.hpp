@@ -0,0 +1,194 @@
+/*
+
+Copyright 2017 University of Rochester
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*/
+
+#ifndef _MSQUEUE_H_
+#define _MSQUEUE_H_
+
+#include <atomic>
+#include "Harness.hpp"
+#include "ConcurrentPrimitives.hpp"
+#include "RUnorderedMap.hpp"
+#include "MemoryTracker.hpp"
+#include "RetiredMonitorable.hpp"
+#include <stdexcept>
+#include <cstdlib>
+
+#ifdef NGC
+#define COLLECT false
+#else
+#define COLLECT true
+#endif
+
+/**
+ * Michael-Scott lock-free queue [PODC'96].
+ *
+ * A lock-free baseline for the wait-free queues. The first node of
+ * the list is always a sentinel; a dequeue swings head to the next
+ * node, takes the item from it and retires the old sentinel.
+ */
+template <class K, class V>
+class MSQueue : public RUnorderedMap<K, V>, public RetiredMonitorable {
+
+private:
+    struct Node {
+        V item;
+        std::atomic<Node*> next;
+
+        Node() : next{nullptr} { }
+
+        Node(V _item) : item{_item}, next{nullptr} { }
+
+        inline bool deletable() {return true;}
+    };
+
+    MemoryTracker<Node>* memory_tracker;
+
+    // To make sure we are not affected by the misaligned object
+    alignas(128) int __pad1;
+
+    // Pointers to head and tail of the list
+    alignas(128) std::atomic<Node*> head;
+    alignas(128) std::atomic<Node*> tail;
+
+    // To make sure we are not affected by the misaligned object
+    alignas(128) int __pad2;
+
+    const int kHpTail = 0;
+    const int kHpHead = 0;
+    const int kHpNext = 1;
+
+public:
+    MSQueue(GlobalTestConfig* gtc): RetiredMonitorable(gtc) {
+        int epochf = gtc->getEnv("epochf").empty()? 150:stoi(gtc->getEnv("epochf"));
+        int emptyf = gtc->getEnv("emptyf").empty()? 30:stoi(gtc->getEnv("emptyf"));
+        std::cout<<"emptyf:"<<emptyf<<std::endl;
+        memory_tracker = new MemoryTracker<Node>(gtc, epochf, emptyf, 2, COLLECT);
+        monitor(memory_tracker);
+        memory_tracker->start_op(0);
+        Node* sentinelNode = mkNode(0);
+        head.store(sentinelNode, std::memory_order_relaxed);
+        tail.store(sentinelNode, std::memory_order_relaxed);
+        memory_tracker->end_op(0);
+        memory_tracker->clear_all(0);
+    }
+
+    ~MSQueue() {
+        optional<V> nullres={};
+        while (remove(0, 0) != nullres); // Drain the queue
+        memory_tracker->start_op(0);
+        memory_tracker->reclaim(head.load(), 0);
+        memory_tracker->end_op(0);
+        memory_tracker->clear_all(0);
+    }
+
+    Node* mkNode(int tid){
+        void* ptr = memory_tracker->alloc(tid);
+        return new (ptr) Node();
+    }
+
+    Node* mkNode(V item, int tid){
+        void* ptr = memory_tracker->alloc(tid);
+        return new (ptr) Node(item);
+    }
+
+    /**
+     * Link the new node after the last node with a CAS on tail->next,
+     * then try to swing tail to it. A lagging tail is helped forward.
+     */
+    bool insert(K __key, V item, int tid) {
+        Node* myNode = mkNode(item, tid);
+        collect_retired_size(memory_tracker->get_retired_cnt(tid), tid);
+        memory_tracker->start_op(tid);
+        while (true) {
+            Node* ltail = memory_tracker->read(tail, kHpTail, tid, nullptr);
+            Node* lnext = ltail->next.load();
+            if (ltail != tail.load()) continue;
+            if (lnext == nullptr) {
+                if (ltail->next.compare_exchange_strong(lnext, myNode)) {
+                    tail.compare_exchange_strong(ltail, myNode);
+                    break;
+                }
+            } else {
+                tail.compare_exchange_strong(ltail, lnext); // Help a lagging enqueuer
+            }
+        }
+        memory_tracker->end_op(tid);
+        memory_tracker->clear_all(tid);
+        return true;
+    }
+
+    /**
+     * Both head and head->next must be protected before the item is read:
+     * once head moves, the old sentinel is retired, and head->next
+     * becomes the new sentinel which the next dequeuer will retire.
+     */
+    optional<V> remove(K __key, int tid) {
+        optional<V> res={};
+        collect_retired_size(memory_tracker->get_retired_cnt(tid), tid);
+        memory_tracker->start_op(tid);
+        while (true) {
+            Node* lhead = memory_tracker->read(head, kHpHead, tid, nullptr);
+            Node* lnext = memory_tracker->read(lhead->next, kHpNext, tid, lhead);
+            if (lhead != head.load()) continue;
+            if (lnext == nullptr) break; // Queue is empty
+            Node* ltail = tail.load();
+            if (lhead == ltail) {
+                tail.compare_exchange_strong(ltail, lnext); // Help a lagging enqueuer
+                continue;
+            }
+            if (head.compare_exchange_strong(lhead, lnext)) {
+                res = lnext->item;
+                memory_tracker->retire(lhead, tid);
+                break;
+            }
+        }
+        memory_tracker->end_op(tid);
+        memory_tracker->clear_all(tid);
+        return res;
+    }
+
+public:
+    optional<V> get(K key, int tid)
+    {
+        optional<V> res={};
+        return res;
+    }
+
+    optional<V> put(K key, V val, int tid)
+    {
+        optional<V> res={};
+        return res;
+    }
+
+    optional<V> replace(K key, V val, int tid)
+    {
+        optional<V> res={};
+        return res;
+    }
+};
+
+template <class K, class V>
+class MSQueueFactory : public RideableFactory {
+    MSQueue<K,V>* build(GlobalTestConfig* gtc) {
+        // C++11 new ignores the 128-byte alignment of head and tail
+        void* ptr = aligned_alloc(alignof(MSQueue<K,V>), sizeof(MSQueue<K,V>));
+        return new (ptr) MSQueue<K,V>(gtc);
+    }
+};
+
+#endif /* _MSQUEUE_H_ */
@@ -23,6 +23,7 @@ limitations under the License.
 #include <iostream>
 #include <atomic>
 #include <algorithm>
+#include <thread>
 #include "Harness.hpp"
 #include "ConcurrentPrimitives.hpp"
 #include "ROrderedMap.hpp"
@@ -47,35 +48,55 @@ template <class K, class V>
 class NatarajanTree : public ROrderedMap<K,V>, public RetiredMonitorable{
 private:
 	/* structs*/
+	/*
+	 * Leaves and internal nodes share one tracked type, since the
+	 * trackers place the birth epoch at sizeof(Node). Only leaves
+	 * hold a value and only internal nodes have children, so the two
+	 * overlap. No vtable: nothing is deleted through a base pointer.
+	 */
 	struct Node{
 		int level;
+		bool leaf;
 		K key;
-		V val;
-		std::atomic<Node*> left;
-		std::atomic<Node*> right;
-
-		virtual ~Node(){};
-		static Node* alloc(K k, V v, Node* l, Node* r,MemoryTracker<Node>* memory_tracker,int tid){//TODO: Switch this func to MemoryTracker one
-			return alloc(k,v,l,r,-1,memory_tracker, tid);
-		}
+		union{
+			V val;
+			struct{
+				std::atomic<Node*> left;
+				std::atomic<Node*> right;
+			};
+		};
+
+		~Node(){
+			if(leaf)
+				val.~V();
+		};
 
 		inline bool deletable() {return true;}
-		static Node* alloc(K k, V v, Node* l, Node* r, int lev, MemoryTracker<Node>* memory_tracker, int tid){
+		static Node* allocLeaf(const K& k, const V& v, int lev, MemoryTracker<Node>* memory_tracker, int tid){
+			while(true){
+				Node* n = (Node*) memory_tracker->alloc(tid);
+				if (n==nullptr) {
+					continue;
+				}
+				new (n) Node(k,v,lev);
+				return n;
+			}
+		}
+		static Node* allocLeaf(const K& k, const V& v, MemoryTracker<Node>* memory_tracker, int tid){
+			return allocLeaf(k,v,-1,memory_tracker,tid);
+		}
+		static Node* allocInternal(const K& k, Node* l, Node* r, int lev, MemoryTracker<Node>* memory_tracker, int tid){
 			while(true){
 				Node* n = (Node*) memory_tracker->alloc(tid);
 				if (n==nullptr) {
-					// std::cout<<"alloc fails\n";
-					continue;//return alloc(a,k,v,l,r,lev);
+					continue;
 				}
-				//don't know how to call constructor for malloc
-				//http://stackoverflow.com/questions/2995099/malloc-and-constructors
-				new (n) Node(k,v,l,r,lev);
+				new (n) Node(k,l,r,lev);
 				return n;
 			}
 		}
-		Node(){};
-		Node(K k, V v, Node* l, Node* r,int lev):level(lev),key(k),val(v),left(l),right(r){};
-		Node(K k, V v, Node* l, Node* r):level(-1),key(k),val(v),left(l),right(r){};
+		Node(const K& k, const V& v, int lev):level(lev),leaf(true),key(k),val(v){};
+		Node(const K& k, Node* l, Node* r, int lev):level(lev),leaf(false),key(k),left(l),right(r){};
 	};
 	struct SeekRecord{
 		Node* ancestor;
@@ -94,6 +115,12 @@ private:
 	Node* s;
 	padded<SeekRecord>* records;
 	const size_t GET_POINTER_BITS = 0xfffffffffffffffc;//for machine 64-bit or less.
+	//reservation slots of rangeScan: the current node, its child, and a
+	//stack of the deepest SCAN_DEPTH nodes whose right subtree is pending.
+	static const int SCAN_DEPTH = 8;
+	static const int SCAN_CUR = 0;
+	static const int SCAN_CHILD = 1;
+	static const int SCAN_STACK = 2;
 
 	/* helper functions */
 	//flag and tags helpers
@@ -118,31 +145,22 @@ private:
 		n=getPtr(n);
 		return n->level;
 	}
-	inline bool nodeLess(Node* n1, Node* n2){
-		n1=getPtr(n1);
-		n2=getPtr(n2);
-		int i1=getInfLevel(n1);
-		int i2=getInfLevel(n2);
-		return i1<i2 || (i1==-1&&i2==-1&&n1->key<n2->key);
-	}
-	inline bool nodeEqual(Node* n1, Node* n2){
-		n1=getPtr(n1);
-		n2=getPtr(n2);
-		int i1=getInfLevel(n1);
-		int i2=getInfLevel(n2);
-		if(i1==-1&&i2==-1)
-			return n1->key==n2->key;
-		else
-			return i1==i2;
+	//whether key routes left of / sits at node n
+	inline bool keyLess(const K& key, Node* n){
+		n=getPtr(n);
+		return n->level!=-1 || key<n->key;
 	}
-	inline bool nodeLessEqual(Node* n1, Node* n2){
-		return !nodeLess(n2,n1);
+	inline bool keyEqual(const K& key, Node* n){
+		n=getPtr(n);
+		return n->level==-1 && key==n->key;
 	}
 
 	/* private interfaces */
-	void seek(K key, int tid);
-	bool cleanup(K key, int tid);
-	void doRangeQuery(Node& k1, Node& k2, int tid, Node* root, std::map<K,V>& res);
+	void seek(const K& key, int tid, Node* stop=nullptr);
+	bool cleanup(const K& key, int tid);
+	void helpSplice(Node* parent, int tid);
+	Node* build(const K* keys, const V* vals, size_t n, int tid, int nthreads);
+	bool doRangeScan(K& lo, const K& hi, bool& exclusive, int& cnt, RangeVisitor<K,V>* visitor, int tid);
 public:
 	NatarajanTree(GlobalTestConfig* gtc): RetiredMonitorable(gtc)
 	//memory_tracker("HE",gtc->task_num,150,200,5,COLLECT)
@@ -151,13 +169,13 @@ public:
 		//memory_tracker = new MemoryTracker<Node>(type, gtc->task_num, 150, 30, 5, COLLECT);
         int epochf = gtc->getEnv("epochf").empty()? 150:stoi(gtc->getEnv("epochf"));
         int emptyf = gtc->getEnv("emptyf").empty()? 30:stoi(gtc->getEnv("emptyf"));
-		memory_tracker = new MemoryTracker<Node>(gtc, epochf, emptyf, 5, COLLECT);
-		r = Node::alloc(infK,defltV,nullptr,nullptr,2,memory_tracker,0);
-		s = Node::alloc(infK,defltV,nullptr,nullptr,1,memory_tracker,0);
-		r->right = Node::alloc(infK,defltV,nullptr,nullptr,2,memory_tracker,0);
-		r->left = s;
-		s->right = Node::alloc(infK,defltV,nullptr,nullptr,1,memory_tracker,0);
-		s->left = Node::alloc(infK,defltV,nullptr,nullptr,0,memory_tracker,0);
+		memory_tracker = new MemoryTracker<Node>(gtc, epochf, emptyf, std::max(5,SCAN_STACK+SCAN_DEPTH), COLLECT);
+		monitor(memory_tracker);
+		s = Node::allocInternal(infK,
+			Node::allocLeaf(infK,defltV,0,memory_tracker,0),
+			Node::allocLeaf(infK,defltV,1,memory_tracker,0),1,memory_tracker,0);
+		r = Node::allocInternal(infK,s,
+			Node::allocLeaf(infK,defltV,2,memory_tracker,0),2,memory_tracker,0);
 		records = new padded<SeekRecord>[gtc->task_num]{};
 	};
 	~NatarajanTree(){};
@@ -168,6 +186,8 @@ public:
 	optional<V> remove(K key, int tid);
 	optional<V> replace(K key, V val, int tid);
 	std::map<K, V> rangeQuery(K key1, K key2, int& len, int tid);
+	int rangeScan(K key1, K key2, RangeVisitor<K,V>* visitor, int tid);
+	void bulkLoad(const K* keys, const V* vals, size_t n, int nthreads);
 };
 
 template <class K, class V> 
@@ -179,9 +199,8 @@ class NatarajanTreeFactory : public RideableFactory{
 
 //-------Definition----------
 template <class K, class V>
-void NatarajanTree<K,V>::seek(K key, int tid){
+void NatarajanTree<K,V>::seek(const K& key, int tid, Node* stop){
 	/* initialize the seek record using sentinel nodes */
-	Node keyNode{key,defltV,nullptr,nullptr};//node to be compared
 	SeekRecord* seekRecord=&(records[tid].ui);
 	seekRecord->ancestor=r;
 	seekRecord->successor=memory_tracker->read(r->left,1,tid,r);
@@ -190,7 +209,9 @@ void NatarajanTree<K,V>::seek(K key, int tid){
 
 	/* initialize other variables used in the traversal */
 	Node* parentField=memory_tracker->read(seekRecord->parent->left,3,tid,seekRecord->parent);
-	Node* currentField=memory_tracker->read(seekRecord->leaf->left,4,tid,seekRecord->leaf);
+	Node* currentField=nullptr;
+	if(!seekRecord->leaf->leaf)
+		currentField=memory_tracker->read(seekRecord->leaf->left,4,tid,seekRecord->leaf);
 	Node* current=getPtr(currentField);
 
 	/* traverse the tree */
@@ -212,10 +233,15 @@ void NatarajanTree<K,V>::seek(K key, int tid){
 		memory_tracker->transfer(3,2,tid);
 		seekRecord->leaf=current;
 		memory_tracker->transfer(4,3,tid);
+		if(seekRecord->parent==stop)
+			return;
 
 		/* update other variables used in traversal */
 		parentField=currentField;
-		if(nodeLess(&keyNode,current)){
+		if(current->leaf){
+			currentField=nullptr;
+		}
+		else if(keyLess(key,current)){
 			currentField=memory_tracker->read(current->left,4,tid,current);
 		}
 		else{
@@ -227,9 +253,27 @@ void NatarajanTree<K,V>::seek(K key, int tid){
 	return;
 }
 
+/*
+ * Finish the removal that tagged an edge of parent, as seek() callers
+ * do for the edge to their leaf. parent's key routes to parent and then
+ * right, so seeking it and stopping at parent gives cleanup() a record
+ * whose leaf is either the flagged child or the tagged one. If parent
+ * is already off that path, its removal is done and there is no help.
+ */
+template <class K, class V>
+void NatarajanTree<K,V>::helpSplice(Node* parent, int tid){
+	K key=parent->key;
+	seek(key,tid,parent);
+	SeekRecord* seekRecord=&(records[tid].ui);
+	if(seekRecord->parent!=parent)
+		return;
+	Node* tmpChild=parent->right.load(std::memory_order_acquire);
+	if(getPtr(tmpChild)==seekRecord->leaf && (getFlg(tmpChild)||getTg(tmpChild)))
+		cleanup(key,tid);
+}
+
 template <class K, class V>
-bool NatarajanTree<K,V>::cleanup(K key, int tid){
-	Node keyNode{key,defltV,nullptr,nullptr};//node to be compared
+bool NatarajanTree<K,V>::cleanup(const K& key, int tid){
 	bool res=false;
 
 	/* retrieve addresses stored in seek record */
@@ -244,13 +288,13 @@ bool NatarajanTree<K,V>::cleanup(K key, int tid){
 	std::atomic<Node*>* siblingAddr=nullptr;
 
 	/* obtain address of field of ancestor node that will be modified */
-	if(nodeLess(&keyNode,ancestor))
+	if(keyLess(key,ancestor))
 		successorAddr=&(ancestor->left);
 	else
 		successorAddr=&(ancestor->right);
 
 	/* obtain addresses of child fields of parent node */
-	if(nodeLess(&keyNode,parent)){
+	if(keyLess(key,parent)){
 		childAddr=&(parent->left);
 		siblingAddr=&(parent->right);
 	}
@@ -308,7 +352,6 @@ bool NatarajanTree<K,V>::cleanup(K key, int tid){
 
 template <class K, class V>
 optional<V> NatarajanTree<K,V>::get(K key, int tid){
-	Node keyNode{key,defltV,nullptr,nullptr};//node to be compared
 	optional<V> res={};
 	SeekRecord* seekRecord=&(records[tid].ui);
 	Node* leaf=nullptr;
@@ -316,7 +359,7 @@ optional<V> NatarajanTree<K,V>::get(K key, int tid){
 	memory_tracker->start_op(tid);
 	seek(key,tid);
 	leaf=getPtr(seekRecord->leaf);
-	if(nodeEqual(&keyNode,leaf)){
+	if(keyEqual(key,leaf)){
 		res = leaf->val;
 	}
 	memory_tracker->clear_all(tid);
@@ -330,7 +373,7 @@ optional<V> NatarajanTree<K,V>::put(K key, V val, int tid){
 	SeekRecord* seekRecord=&(records[tid].ui);
 
 	Node* newInternal=nullptr;
-	Node* newLeaf=Node::alloc(key,val,nullptr,nullptr,memory_tracker,tid);//also to compare keys
+	Node* newLeaf=Node::allocLeaf(key,val,memory_tracker,tid);
 
 	Node* parent=nullptr;
 	Node* leaf=nullptr;
@@ -342,9 +385,9 @@ optional<V> NatarajanTree<K,V>::put(K key, V val, int tid){
 		seek(key,tid);
 		leaf=getPtr(seekRecord->leaf);
 		parent=getPtr(seekRecord->parent);
-		if(!nodeEqual(newLeaf,leaf)){//key does not exist
+		if(!keyEqual(key,leaf)){//key does not exist
 			/* obtain address of the child field to be modified */
-			if(nodeLess(newLeaf,parent))
+			if(keyLess(key,parent))
 				childAddr=&(parent->left);
 			else
 				childAddr=&(parent->right);
@@ -352,7 +395,7 @@ optional<V> NatarajanTree<K,V>::put(K key, V val, int tid){
 			/* create left and right leave of newInternal */
 			Node* newLeft=nullptr;
 			Node* newRight=nullptr;
-			if(nodeLess(newLeaf,leaf)){
+			if(keyLess(key,leaf)){
 				newLeft=newLeaf;
 				newRight=leaf;
 			}
@@ -364,10 +407,10 @@ optional<V> NatarajanTree<K,V>::put(K key, V val, int tid){
 			/* create newInternal */
 			if(isInf(leaf)){
 				int lev=getInfLevel(leaf);
-				newInternal=Node::alloc(infK,defltV,newLeft,newRight,lev,memory_tracker,tid);
+				newInternal=Node::allocInternal(infK,newLeft,newRight,lev,memory_tracker,tid);
 			}
 			else
-				newInternal=Node::alloc(std::max(key,leaf->key),defltV,newLeft,newRight,memory_tracker,tid);
+				newInternal=Node::allocInternal(std::max(key,leaf->key),newLeft,newRight,-1,memory_tracker,tid);
 
 			/* try to add the new nodes to the tree */
 			Node* tmpExpected=getPtr(leaf);
@@ -390,7 +433,7 @@ optional<V> NatarajanTree<K,V>::put(K key, V val, int tid){
 		}
 		else{//key exists, update and return old
 			res=leaf->val;
-			if(nodeLess(newLeaf,parent))
+			if(keyLess(key,parent))
 				childAddr=&(parent->left);
 			else
 				childAddr=&(parent->right);
@@ -411,7 +454,7 @@ bool NatarajanTree<K,V>::insert(K key, V val, int tid){
 	SeekRecord* seekRecord=&(records[tid].ui);
 	
 	Node* newInternal=nullptr;
-	Node* newLeaf=Node::alloc(key,val,nullptr,nullptr,memory_tracker,tid);//also for comparing keys
+	Node* newLeaf=Node::allocLeaf(key,val,memory_tracker,tid);
 	
 	Node* parent=nullptr;
 	Node* leaf=nullptr;
@@ -422,9 +465,9 @@ bool NatarajanTree<K,V>::insert(K key, V val, int tid){
 		seek(key,tid);
 		leaf=getPtr(seekRecord->leaf);
 		parent=getPtr(seekRecord->parent);
-		if(!nodeEqual(newLeaf,leaf)){//key does not exist
+		if(!keyEqual(key,leaf)){//key does not exist
 			/* obtain address of the child field to be modified */
-			if(nodeLess(newLeaf,parent))
+			if(keyLess(key,parent))
 				childAddr=&(parent->left);
 			else
 				childAddr=&(parent->right);
@@ -432,7 +475,7 @@ bool NatarajanTree<K,V>::insert(K key, V val, int tid){
 			/* create left and right leave of newInternal */
 			Node* newLeft=nullptr;
 			Node* newRight=nullptr;
-			if(nodeLess(newLeaf,leaf)){
+			if(keyLess(key,leaf)){
 				newLeft=newLeaf;
 				newRight=leaf;
 			}
@@ -444,10 +487,10 @@ bool NatarajanTree<K,V>::insert(K key, V val, int tid){
 			/* create newInternal */
 			if(isInf(leaf)){
 				int lev=getInfLevel(leaf);
-				newInternal=Node::alloc(infK,defltV,newLeft,newRight,lev,memory_tracker,tid);
+				newInternal=Node::allocInternal(infK,newLeft,newRight,lev,memory_tracker,tid);
 			}
 			else
-				newInternal=Node::alloc(std::max(key,leaf->key),defltV,newLeft,newRight,memory_tracker,tid);
+				newInternal=Node::allocInternal(std::max(key,leaf->key),newLeft,newRight,-1,memory_tracker,tid);
 
 			/* try to add the new nodes to the tree */
 			Node* tmpExpected=getPtr(leaf);
@@ -485,8 +528,6 @@ optional<V> NatarajanTree<K,V>::remove(K key, int tid){
 	optional<V> res={};
 	SeekRecord* seekRecord=&(records[tid].ui);
 
-	Node keyNode{key,defltV,nullptr,nullptr};//node to be compared
-	
 	Node* parent=nullptr;
 	Node* leaf=nullptr;
 	std::atomic<Node*>* childAddr=nullptr;
@@ -496,7 +537,7 @@ optional<V> NatarajanTree<K,V>::remove(K key, int tid){
 		seek(key,tid);
 		parent=getPtr(seekRecord->parent);
 		/* obtain address of the child field to be modified */
-		if(nodeLess(&keyNode,parent))
+		if(keyLess(key,parent))
 			childAddr=&(parent->left);
 		else
 			childAddr=&(parent->right);
@@ -504,7 +545,7 @@ optional<V> NatarajanTree<K,V>::remove(K key, int tid){
 		if(injecting){
 			/* injection mode: check if the key exists */
 			leaf=getPtr(seekRecord->leaf);
-			if(!nodeEqual(leaf,&keyNode)){//does not exist
+			if(!keyEqual(key,leaf)){//does not exist
 				res={};
 				break;
 			}
@@ -554,7 +595,7 @@ optional<V> NatarajanTree<K,V>::replace(K key, V val, int tid){
 	SeekRecord* seekRecord=&(records[tid].ui);
 
 	Node* newInternal=nullptr;
-	Node* newLeaf=Node::alloc(key,val,nullptr,nullptr,memory_tracker,tid);//also to compare keys
+	Node* newLeaf=Node::allocLeaf(key,val,memory_tracker,tid);
 
 	Node* parent=nullptr;
 	Node* leaf=nullptr;
@@ -565,14 +606,14 @@ optional<V> NatarajanTree<K,V>::replace(K key, V val, int tid){
 		seek(key,tid);
 		parent=getPtr(seekRecord->parent);
 		leaf=getPtr(seekRecord->leaf);
-		if(!nodeEqual(newLeaf,leaf)){//key does not exist, replace fails
+		if(!keyEqual(key,leaf)){//key does not exist, replace fails
 			memory_tracker->reclaim(newLeaf, tid);
 			res={};
 			break;
 		}
 		else{//key exists, update and return old
 			res=leaf->val;
-			if(nodeLess(newLeaf,parent))
+			if(keyLess(key,parent))
 				childAddr=&(parent->left);
 			else
 				childAddr=&(parent->right);
@@ -587,48 +628,135 @@ optional<V> NatarajanTree<K,V>::replace(K key, V val, int tid){
 	return res;
 }
 
+/* builds a balanced subtree over sorted leaves, splitting the threads */
+template <class K, class V>
+typename NatarajanTree<K,V>::Node* NatarajanTree<K,V>::build(const K* keys, const V* vals, size_t n, int tid, int nthreads){
+	if(n==1)
+		return Node::allocLeaf(keys[0],vals[0],memory_tracker,tid);
+	size_t mid=n/2;
+	Node* left=nullptr;
+	Node* right=nullptr;
+	if(nthreads>1){
+		int half=nthreads/2;
+		std::thread helper([&]{
+			left=build(keys,vals,mid,tid+half,nthreads-half);
+		});
+		right=build(keys+mid,vals+mid,n-mid,tid,half);
+		helper.join();
+	}
+	else{
+		left=build(keys,vals,mid,tid,1);
+		right=build(keys+mid,vals+mid,n-mid,tid,1);
+	}
+	return Node::allocInternal(keys[mid],left,right,-1,memory_tracker,tid);
+}
+
+template <class K, class V>
+void NatarajanTree<K,V>::bulkLoad(const K* keys, const V* vals, size_t n, int nthreads){
+	Node* inf0=s->left.load(std::memory_order_acquire);
+	if(!inf0->leaf){//not empty
+		ROrderedMap<K,V>::bulkLoad(keys,vals,n,nthreads);
+		return;
+	}
+	if(n==0) return;
+	/* same shape as the first insert: real keys left of an inf0 node */
+	Node* root=build(keys,vals,n,0,nthreads);
+	s->left.store(Node::allocInternal(infK,root,inf0,0,memory_tracker,0),std::memory_order_release);
+}
+
 template <class K, class V>
 std::map<K, V> NatarajanTree<K,V>::rangeQuery(K key1, K key2, int& len, int tid){
-	//NOT HP-like GC safe.
-	if(key1>key2) return {};
-	Node k1{key1,defltV,nullptr,nullptr};//node to be compared
-	Node k2{key2,defltV,nullptr,nullptr};//node to be compared
+	RangeCollector<K,V> collector;
+	len=rangeScan(key1,key2,&collector,tid);
+	return collector.res;
+}
+
+template <class K, class V>
+int NatarajanTree<K,V>::rangeScan(K key1, K key2, RangeVisitor<K,V>* visitor, int tid){
+	if(key1>key2) return 0;
+	K lo=key1;//scan cursor
+	bool exclusive=false;
+	int cnt=0;
 
 	collect_retired_size(memory_tracker->get_retired_cnt(tid), tid);
 	memory_tracker->start_op(tid);
-	
-	Node* leaf=getPtr(memory_tracker->read(s->left,0,tid,s));
-	Node* current=getPtr(memory_tracker->read(leaf->left,1,tid,leaf));
-
-	std::map<K,V> res;
-	if(current!=nullptr)
-		doRangeQuery(k1,k2,tid,current,res);
-	len=res.size();
+	while(!doRangeScan(lo,key2,exclusive,cnt,visitor,tid)){}
+	memory_tracker->clear_all(tid);
 	memory_tracker->end_op(tid);
-	return res;
+	return cnt;
 }
 
+/*
+ * Iterative in-order walk from s, resuming after the cursor lo.
+ * An internal node loses its tree position only after both its child
+ * edges are flagged or tagged, and marked edges never change. So a
+ * child read from a reserved node through a clean edge was reachable
+ * at the read, and is safe under Hazard, HE and WFE alike. A flagged
+ * edge leads to a logically deleted leaf, which is skipped; a tagged
+ * one means the parent is being spliced out, so the walk helps finish
+ * that with helpSplice() and restarts, and a stalled remover cannot
+ * hold it up. helpSplice() reuses the seek slots, which is fine since
+ * the restart reads everything again from s.
+ * It also restarts, from the cursor, when the stack of pending right
+ * subtrees overflowed and runs dry. Returns false on restart.
+ */
 template <class K, class V>
-void NatarajanTree<K,V>::doRangeQuery(Node& k1, Node& k2, int tid, Node* root, std::map<K,V>& res){
-	Node* left=getPtr(memory_tracker->read(root->left,2,tid,root));
-	Node* right=getPtr(memory_tracker->read(root->right,3,tid,root));
-	if(left==nullptr&&right==nullptr){
-		if(nodeLessEqual(&k1,root)&&nodeLessEqual(root,&k2)){
-			
-			res.emplace(root->key,root->val);
+bool NatarajanTree<K,V>::doRangeScan(K& lo, const K& hi, bool& exclusive, int& cnt, RangeVisitor<K,V>* visitor, int tid){
+	Node* stack[SCAN_DEPTH];
+	int top=0;
+	int bottom=0;
+	Node* n=s;//s and its edges are never retired or marked
+	while(true){
+		Node* childField=nullptr;
+		Node* from=n;
+		if(n!=nullptr){
+			/* descend towards the first key after the cursor */
+			if(keyLess(lo,n)){
+				childField=memory_tracker->read(n->left,SCAN_CHILD,tid,n);
+				if(!keyLess(hi,n)){
+					if(top-bottom==SCAN_DEPTH)
+						bottom++;
+					stack[top%SCAN_DEPTH]=n;
+					memory_tracker->transfer(SCAN_CUR,SCAN_STACK+top%SCAN_DEPTH,tid);
+					top++;
+				}
+			}
+			else{
+				childField=memory_tracker->read(n->right,SCAN_CHILD,tid,n);
+			}
 		}
-		return;
-	}
-	if(left!=nullptr){
-		if(nodeLess(&k1,root)){
-			doRangeQuery(k1,k2,tid,left,res);
+		else{
+			/* go on with the closest pending right subtree */
+			if(top==bottom)
+				return bottom==0;
+			top--;
+			from=stack[top%SCAN_DEPTH];
+			childField=memory_tracker->read(from->right,SCAN_CHILD,tid,from);
 		}
-	}
-	if(right!=nullptr){
-		if(nodeLessEqual(root,&k2)){
-			doRangeQuery(k1,k2,tid,right,res);
+
+		if(getFlg(childField)){
+			n=nullptr;
+			continue;
+		}
+		if(getTg(childField)){
+			helpSplice(from,tid);
+			return false;
 		}
+		Node* child=getPtr(childField);
+		if(!child->leaf){
+			memory_tracker->transfer(SCAN_CHILD,SCAN_CUR,tid);
+			n=child;
+			continue;
+		}
+		if(keyLess(hi,child))
+			return true;
+		if(keyLess(lo,child) || (!exclusive && keyEqual(lo,child))){
+			visitor->visit(child->key,child->val);
+			cnt++;
+			lo=child->key;
+			exclusive=true;
+		}
+		n=nullptr;
 	}
-	return;
 }
 #endif
@@ -0,0 +1,431 @@
+/*
+
+Copyright 2017 University of Rochester
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*/
+
+
+#ifndef RADIX_TREE
+#define RADIX_TREE
+
+#include <iostream>
+#include <atomic>
+#include "Harness.hpp"
+#include "ConcurrentPrimitives.hpp"
+#include "ROrderedMap.hpp"
+#include "RUnorderedMap.hpp"
+#include "MemoryTracker.hpp"
+#include "RetiredMonitorable.hpp"
+#include "LLXSCX.hpp"
+
+#ifdef NGC
+#define COLLECT false
+#else
+#define COLLECT true
+#endif
+
+/*
+ * A lock-free path-compressed radix tree for int keys, 4 bits per
+ * level, so a lookup visits at most 8 nodes whatever the key order.
+ * Keys are stored with the sign bit flipped, which makes the child
+ * order the same as the int order for range queries.
+ *
+ * Leaf-oriented and built with LLX/SCX like a k-ary search tree
+ * [Brown and Helga, OPODIS'11]: inner nodes are copied to change a
+ * child, and the old copy is retired. An insert that lands on an
+ * occupied slot grows the tree by a new inner node at the first
+ * differing nibble; a remove that leaves an inner node with a single
+ * child shrinks the tree by splicing that child into the node's place.
+ * Non-root inner nodes always have at least two children.
+ */
+template <class V>
+class RadixTree : public ROrderedMap<int,V>, public RetiredMonitorable{
+private:
+	static const int FANOUT = 16;
+	static const int TOP_SHIFT = 28;
+	static const int LEAF_SHIFT = -4;
+
+	/* structs*/
+	struct Node{
+		int shift;//position of the nibble an inner node branches on, LEAF_SHIFT for leaves
+		uint32_t bits;//the key bits above that nibble; the whole key for leaves
+		V val;
+		std::atomic<uint64_t> info;
+		std::atomic<bool> marked;
+		std::atomic<Node*> child[FANOUT];
+
+		inline bool isLeaf() {return shift==LEAF_SHIFT;}
+		inline bool deletable() {return true;}
+		Node(int s, uint32_t b):shift(s),bits(b),info(0),marked(false){
+			for(int i=0;i<FANOUT;i++){
+				child[i].store(nullptr,std::memory_order_relaxed);
+			}
+		};
+	};
+	struct SeekRecord{
+		Node* gp;
+		Node* p;
+		Node* l;//may be null
+		int pidx;//index of p in gp
+		int lidx;//index of l in p
+	};
+	enum UpdateMode {INSERT, PUT, REPLACE};
+
+	/* variables */
+	MemoryTracker<Node>* memory_tracker;
+	LLXSCX<Node,2>* prim;
+	Node* entry;//sentinel with the root as its only child
+
+	const int kGp = 0;
+	const int kP = 1;
+	const int kL = 2;
+	const int kHelp = 3;//2 slots for helping an SCX
+	//reservation slots of rangeScan: the child being read, and the path
+	//from the root, which is at most one inner node per nibble deep
+	static const int SCAN_DEPTH = TOP_SHIFT/4+1;
+	static const int SCAN_CHILD = 0;
+	static const int SCAN_PATH = 1;
+
+	/* helper functions */
+	inline uint32_t toBits(int key){
+		return ((uint32_t)key)^0x80000000u;
+	}
+	inline int nibble(uint32_t bits, int shift){
+		return (bits>>shift)&(FANOUT-1);
+	}
+	// does key belong under n?
+	inline bool prefixMatch(Node* n, uint32_t bits){
+		return ((uint64_t)bits>>(n->shift+4))==n->bits;
+	}
+	inline Node* mkNode(int shift, uint32_t bits, int tid){
+		void* ptr = memory_tracker->alloc(tid);
+		return new (ptr) Node(shift,bits);
+	}
+	inline Node* mkLeaf(uint32_t bits, V val, int tid){
+		Node* n = mkNode(LEAF_SHIFT,bits,tid);
+		n->val=val;
+		return n;
+	}
+	inline Node* copyInner(Node* p, Node** kids, int tid){
+		Node* n = mkNode(p->shift,p->bits,tid);
+		for(int i=0;i<FANOUT;i++){
+			n->child[i].store(kids[i],std::memory_order_relaxed);
+		}
+		return n;
+	}
+
+	/* private interfaces */
+	void search(uint32_t bits, int tid, SeekRecord& rec);
+	optional<V> update(int key, V val, UpdateMode mode, bool& inserted, int tid);
+	bool doRangeScan(uint64_t& lo, uint32_t hi, int& cnt, RangeVisitor<int,V>* visitor, int tid);
+public:
+	RadixTree(GlobalTestConfig* gtc): RetiredMonitorable(gtc){
+		int epochf = gtc->getEnv("epochf").empty()? 150:stoi(gtc->getEnv("epochf"));
+		int emptyf = gtc->getEnv("emptyf").empty()? 30:stoi(gtc->getEnv("emptyf"));
+		memory_tracker = new MemoryTracker<Node>(gtc, epochf, emptyf, std::max(5,SCAN_PATH+SCAN_DEPTH), COLLECT);
+		monitor(memory_tracker);
+		prim = new LLXSCX<Node,2>(gtc, memory_tracker, kHelp);
+		entry = mkNode(TOP_SHIFT+4,0,0);
+		entry->child[0].store(mkNode(TOP_SHIFT,0,0));
+	};
+	~RadixTree(){};
+
+	optional<V> get(int key, int tid);
+	optional<V> put(int key, V val, int tid);
+	bool insert(int key, V val, int tid);
+	optional<V> remove(int key, int tid);
+	optional<V> replace(int key, V val, int tid);
+	std::map<int, V> rangeQuery(int key1, int key2, int& len, int tid);
+	int rangeScan(int key1, int key2, RangeVisitor<int,V>* visitor, int tid);
+};
+
+template <class V>
+class RadixTreeFactory : public RideableFactory{
+	RadixTree<V>* build(GlobalTestConfig* gtc){
+		return new RadixTree<V>(gtc);
+	}
+};
+
+//-------Definition----------
+/*
+ * Walks down to the inner node p whose child slot lidx holds the key,
+ * or would hold it. l is what that slot holds: null, the leaf for the
+ * key, or a node that does not contain the key (a leaf for another
+ * key, or an inner node with a different prefix).
+ */
+template <class V>
+void RadixTree<V>::search(uint32_t bits, int tid, SeekRecord& rec){
+	while(true){
+		Node* gp=entry;//never retired
+		Node* p=memory_tracker->read(entry->child[0],kP,tid,entry);
+		Node* l;
+		int pidx=0;
+		int lidx;
+		bool restart=false;
+		while(true){
+			lidx=nibble(bits,p->shift);
+			l=memory_tracker->read(p->child[lidx],kL,tid,p);
+			/*
+			 * p is still in the tree, so l was not retired
+			 * before we reserved it.
+			 */
+			if(p->marked.load()){
+				restart=true;
+				break;
+			}
+			if(l==nullptr || l->isLeaf() || !prefixMatch(l,bits)) break;
+			memory_tracker->transfer(kP,kGp,tid);
+			memory_tracker->transfer(kL,kP,tid);
+			gp=p;
+			p=l;
+			pidx=lidx;
+		}
+		if(restart) continue;
+		rec.gp=gp;
+		rec.p=p;
+		rec.l=l;
+		rec.pidx=pidx;
+		rec.lidx=lidx;
+		return;
+	}
+}
+
+template <class V>
+optional<V> RadixTree<V>::update(int key, V val, UpdateMode mode, bool& inserted, int tid){
+	typedef typename LLXSCX<Node,2>::LLXResult LLXResult;
+	const LLXResult ok = LLXSCX<Node,2>::LLX_SNAPSHOT;
+	optional<V> res={};
+	uint32_t bits=toBits(key);
+	SeekRecord rec;
+	inserted=false;
+	collect_retired_size(memory_tracker->get_retired_cnt(tid), tid);
+	memory_tracker->start_op(tid);
+	while(true){
+		search(bits,tid,rec);
+		Node* gp=rec.gp;
+		Node* p=rec.p;
+		Node* l=rec.l;
+		bool found=(l!=nullptr && l->isLeaf() && l->bits==bits);
+		if((found && mode==INSERT) || (!found && mode==REPLACE)){
+			break;
+		}
+
+		Node* nodes[2]={gp,p};
+		uint64_t infos[2];
+		Node* gsnap[FANOUT];
+		Node* psnap[FANOUT];
+		if(prim->llx(gp,gsnap,FANOUT,&infos[0],tid)!=ok || gsnap[rec.pidx]!=p) continue;
+		if(prim->llx(p,psnap,FANOUT,&infos[1],tid)!=ok || psnap[rec.lidx]!=l) continue;
+
+		Node* leaf=mkLeaf(bits,val,tid);
+		Node* inner=nullptr;
+		if(l==nullptr || found){
+			psnap[rec.lidx]=leaf;
+		}
+		else{
+			/* grow: branch on the highest nibble where l and key differ */
+			int lshift=l->shift+4;
+			uint64_t lbits=(uint64_t)l->bits<<lshift;
+			uint32_t diff=(uint32_t)((bits^lbits)>>lshift<<lshift);
+			int s=(31-__builtin_clz(diff))/4*4;
+			inner=mkNode(s,(uint64_t)bits>>(s+4),tid);
+			inner->child[nibble(bits,s)].store(leaf,std::memory_order_relaxed);
+			inner->child[nibble((uint32_t)lbits,s)].store(l,std::memory_order_relaxed);
+			psnap[rec.lidx]=inner;
+		}
+		Node* n=copyInner(p,psnap,tid);
+		if(prim->scx(nodes,infos,2,0x2,&gp->child[rec.pidx],p,n,tid)){
+			memory_tracker->retire(p,tid);
+			if(found){
+				res=l->val;
+				memory_tracker->retire(l,tid);
+			}
+			else{
+				inserted=true;
+			}
+			break;
+		}
+		memory_tracker->reclaim(n,tid);
+		memory_tracker->reclaim(leaf,tid);
+		if(inner!=nullptr) memory_tracker->reclaim(inner,tid);
+	}
+	memory_tracker->clear_all(tid);
+	memory_tracker->end_op(tid);
+	return res;
+}
+
+template <class V>
+optional<V> RadixTree<V>::get(int key, int tid){
+	optional<V> res={};
+	uint32_t bits=toBits(key);
+	SeekRecord rec;
+	collect_retired_size(memory_tracker->get_retired_cnt(tid), tid);
+	memory_tracker->start_op(tid);
+	search(bits,tid,rec);
+	Node* l=rec.l;
+	if(l!=nullptr && l->isLeaf() && l->bits==bits){
+		res=l->val;
+	}
+	memory_tracker->clear_all(tid);
+	memory_tracker->end_op(tid);
+	return res;
+}
+
+template <class V>
+optional<V> RadixTree<V>::put(int key, V val, int tid){
+	bool inserted;
+	return update(key,val,PUT,inserted,tid);
+}
+
+template <class V>
+bool RadixTree<V>::insert(int key, V val, int tid){
+	bool inserted;
+	update(key,val,INSERT,inserted,tid);
+	return inserted;
+}
+
+template <class V>
+optional<V> RadixTree<V>::replace(int key, V val, int tid){
+	bool inserted;
+	return update(key,val,REPLACE,inserted,tid);
+}
+
+template <class V>
+optional<V> RadixTree<V>::remove(int key, int tid){
+	typedef typename LLXSCX<Node,2>::LLXResult LLXResult;
+	const LLXResult ok = LLXSCX<Node,2>::LLX_SNAPSHOT;
+	optional<V> res={};
+	uint32_t bits=toBits(key);
+	SeekRecord rec;
+	collect_retired_size(memory_tracker->get_retired_cnt(tid), tid);
+	memory_tracker->start_op(tid);
+	while(true){
+		search(bits,tid,rec);
+		Node* gp=rec.gp;
+		Node* p=rec.p;
+		Node* l=rec.l;
+		if(l==nullptr || !l->isLeaf() || l->bits!=bits){
+			break;
+		}
+
+		Node* nodes[2]={gp,p};
+		uint64_t infos[2];
+		Node* gsnap[FANOUT];
+		Node* psnap[FANOUT];
+		if(prim->llx(gp,gsnap,FANOUT,&infos[0],tid)!=ok || gsnap[rec.pidx]!=p) continue;
+		if(prim->llx(p,psnap,FANOUT,&infos[1],tid)!=ok || psnap[rec.lidx]!=l) continue;
+
+		psnap[rec.lidx]=nullptr;
+		Node* last=nullptr;
+		int remaining=0;
+		for(int i=0;i<FANOUT;i++){
+			if(psnap[i]!=nullptr){
+				last=psnap[i];
+				remaining++;
+			}
+		}
+		/* shrink: splice out an inner node left with one child, except the root */
+		Node* n=(remaining==1 && gp!=entry)? last:copyInner(p,psnap,tid);
+		if(prim->scx(nodes,infos,2,0x2,&gp->child[rec.pidx],p,n,tid)){
+			res=l->val;
+			memory_tracker->retire(p,tid);
+			memory_tracker->retire(l,tid);
+			break;
+		}
+		if(n!=last) memory_tracker->reclaim(n,tid);
+	}
+	memory_tracker->clear_all(tid);
+	memory_tracker->end_op(tid);
+	return res;
+}
+
+template <class V>
+std::map<int, V> RadixTree<V>::rangeQuery(int key1, int key2, int& len, int tid){
+	RangeCollector<int,V> collector;
+	len=rangeScan(key1,key2,&collector,tid);
+	return collector.res;
+}
+
+template <class V>
+int RadixTree<V>::rangeScan(int key1, int key2, RangeVisitor<int,V>* visitor, int tid){
+	if(key1>key2) return 0;
+	uint64_t lo=toBits(key1);//scan cursor, the first key not yet visited
+	int cnt=0;
+
+	collect_retired_size(memory_tracker->get_retired_cnt(tid), tid);
+	memory_tracker->start_op(tid);
+	while(!doRangeScan(lo,toBits(key2),cnt,visitor,tid)){}
+	memory_tracker->clear_all(tid);
+	memory_tracker->end_op(tid);
+	return cnt;
+}
+
+/*
+ * Iterative walk from the root, starting at the cursor lo. The whole
+ * path stays reserved, one slot per level. As in search(), a child read
+ * from a node that is still unmarked afterwards was not retired before
+ * it was reserved; a marked node means the path went off the tree, and
+ * the walk returns false to restart from the cursor.
+ */
+template <class V>
+bool RadixTree<V>::doRangeScan(uint64_t& lo, uint32_t hi, int& cnt, RangeVisitor<int,V>* visitor, int tid){
+	Node* path[SCAN_DEPTH];
+	int idx[SCAN_DEPTH];
+	int d=0;
+	if(lo>hi) return true;//past the largest key
+	path[0]=memory_tracker->read(entry->child[0],SCAN_PATH,tid,entry);//entry is never retired
+	idx[0]=nibble(lo,TOP_SHIFT);
+	while(d>=0){
+		Node* p=path[d];
+		if(idx[d]==FANOUT){
+			if(--d>=0) idx[d]++;
+			continue;
+		}
+		// child i holds the keys in [first, first+span)
+		uint64_t span=1ULL<<p->shift;
+		uint64_t first=((uint64_t)p->bits<<(p->shift+4))+idx[d]*span;
+		if(first>hi) return true;
+
+		Node* c=memory_tracker->read(p->child[idx[d]],SCAN_CHILD,tid,p);
+		if(p->marked.load())
+			return false;
+		if(c==nullptr){
+			idx[d]++;
+		}
+		else if(c->isLeaf()){
+			if(c->bits>hi) return true;
+			if(c->bits>=lo){
+				visitor->visit((int)(c->bits^0x80000000u),c->val);
+				cnt++;
+				lo=(uint64_t)c->bits+1;
+			}
+			idx[d]++;
+		}
+		else{
+			uint64_t cfirst=(uint64_t)c->bits<<(c->shift+4);
+			if(cfirst+(1ULL<<(c->shift+4))<=lo){
+				idx[d]++;
+				continue;
+			}
+			if(cfirst>hi) return true;
+			d++;
+			memory_tracker->transfer(SCAN_CHILD,SCAN_PATH+d,tid);
+			path[d]=c;
+			idx[d]=(cfirst>=lo)? 0:nibble(lo,c->shift);
+		}
+	}
+	return true;
+}
+#endif
@@ -31,6 +31,8 @@ limitations under the License.
 #include <stdio.h>
 #include <stdlib.h>
 #include <iostream>
+#include <thread>
+#include <vector>
 
 #ifdef NGC
 #define COLLECT false
@@ -64,6 +66,9 @@ private:
 	
 	MemoryTracker<Node>* memory_tracker;
 
+	// keys whose bucket and first node are prefetched together by multiGet
+	static const size_t MULTIGET_GROUP = 16;
+
 	const size_t GET_POINTER_BITS = 0xfffffffffffffffe;
 	inline Node* getPtr(Node* mptr){
 		return (Node*) ((size_t)mptr & GET_POINTER_BITS);
@@ -85,6 +90,7 @@ public:
         int emptyf = gtc->getEnv("emptyf").empty()? 30:stoi(gtc->getEnv("emptyf"));
 		std::cout<<"emptyf:"<<emptyf<<std::endl;
 		memory_tracker = new MemoryTracker<Node>(gtc, epochf, emptyf, 3, COLLECT);
+		monitor(memory_tracker);
 	}
 	~SortedUnorderedMap(){};
 
@@ -95,10 +101,12 @@ public:
 
 
 	optional<V> get(K key, int tid);
+	void multiGet(const K* keys, optional<V>* results, size_t n, int tid);
 	optional<V> put(K key, V val, int tid);
 	bool insert(K key, V val, int tid);
 	optional<V> remove(K key, int tid);
 	optional<V> replace(K key, V val, int tid);
+	void bulkLoad(const K* keys, const V* vals, size_t n, int nthreads);
 };
 
 template <class K, class V> 
@@ -127,6 +135,45 @@ optional<V> SortedUnorderedMap<K,V>::get(K key, int tid) {
 	return res;
 }
 
+/*
+ * Group prefetching: for each group of keys, touch every bucket, then
+ * every first node, and only then walk the chains, so that the misses
+ * of independent keys overlap. The prefetched head is read without
+ * protection, which is harmless since a prefetch never faults; the
+ * walk itself goes through findNode as usual.
+ */
+template <class K, class V> 
+void SortedUnorderedMap<K,V>::multiGet(const K* keys, optional<V>* results, size_t n, int tid) {
+	MarkPtr* prev=nullptr;
+	Node* cur=nullptr;
+	Node* nxt=nullptr;
+	size_t idx[MULTIGET_GROUP];
+
+	collect_retired_size(memory_tracker->get_retired_cnt(tid), tid);
+
+	memory_tracker->start_op(tid);
+	for(size_t base=0;base<n;base+=MULTIGET_GROUP){
+		size_t m=(n-base<MULTIGET_GROUP)? n-base : MULTIGET_GROUP;
+		for(size_t j=0;j<m;j++){
+			idx[j]=hash_fn(keys[base+j])%idxSize;
+			__builtin_prefetch(&bucket[idx[j]].ui);
+		}
+		for(size_t j=0;j<m;j++){
+			Node* head=getPtr(bucket[idx[j]].ui.ptr.load(std::memory_order_relaxed));
+			if(head!=nullptr)
+				__builtin_prefetch(head);
+		}
+		for(size_t j=0;j<m;j++){
+			if(findNode(prev,cur,nxt,keys[base+j],tid))
+				results[base+j]=cur->val;
+			else
+				results[base+j]={};
+		}
+	}
+	memory_tracker->clear_all(tid);
+	memory_tracker->end_op(tid);
+}
+
 template <class K, class V> 
 optional<V> SortedUnorderedMap<K,V>::put(K key, V val, int tid) {
 	Node* tmpNode = nullptr;
@@ -303,4 +350,74 @@ bool SortedUnorderedMap<K,V>::findNode(MarkPtr* &prev, Node* &cur, Node* &nxt, K
 		}
 	}
 }
+
+/*
+ * Links every bucket directly: thread t owns a contiguous range of
+ * buckets and prepends their keys from the largest down, so each
+ * bucket comes out sorted without a single CAS. The key indices are
+ * first counting-sorted by owning thread, stable so the order of keys
+ * within a bucket is kept, and each thread walks only its own slice.
+ */
+template <class K, class V> 
+void SortedUnorderedMap<K,V>::bulkLoad(const K* keys, const V* vals, size_t n, int nthreads){
+	for(int i=0;i<idxSize;i++){
+		if(bucket[i].ui.ptr.load(std::memory_order_acquire)!=nullptr){//not empty
+			RUnorderedMap<K,V>::bulkLoad(keys,vals,n,nthreads);
+			return;
+		}
+	}
+	std::vector<size_t> idx(n);
+	std::vector<size_t> order(n);
+	// hist[t*nthreads+o]: keys of thread t's chunk owned by thread o,
+	// turned into where thread t scatters them in order
+	std::vector<size_t> hist((size_t)nthreads*nthreads,0);
+	std::vector<std::thread> threads;
+	for(int t=0;t<nthreads;t++){
+		threads.emplace_back([&,t]{
+			for(size_t i=n*t/nthreads;i<n*(t+1)/nthreads;i++){
+				idx[i]=hash_fn(keys[i])%idxSize;
+				hist[(size_t)t*nthreads+idx[i]*nthreads/idxSize]++;
+			}
+		});
+	}
+	for(auto& th : threads){
+		th.join();
+	}
+	threads.clear();
+	std::vector<size_t> slice(nthreads+1);
+	size_t sum=0;
+	for(int o=0;o<nthreads;o++){
+		slice[o]=sum;
+		for(int t=0;t<nthreads;t++){
+			size_t c=hist[(size_t)t*nthreads+o];
+			hist[(size_t)t*nthreads+o]=sum;
+			sum+=c;
+		}
+	}
+	slice[nthreads]=sum;
+	for(int t=0;t<nthreads;t++){
+		threads.emplace_back([&,t]{
+			for(size_t i=n*t/nthreads;i<n*(t+1)/nthreads;i++){
+				order[hist[(size_t)t*nthreads+idx[i]*nthreads/idxSize]++]=i;
+			}
+		});
+	}
+	for(auto& th : threads){
+		th.join();
+	}
+	threads.clear();
+	for(int t=0;t<nthreads;t++){
+		threads.emplace_back([&,t]{
+			for(size_t j=slice[t+1];j-->slice[t];){
+				size_t i=order[j];
+				MarkPtr* head=&bucket[idx[i]].ui;
+				head->ptr.store(mkNode(keys[i],vals[i],head->ptr.load(std::memory_order_relaxed),t),
+					std::memory_order_relaxed);
+			}
+		});
+	}
+	for(auto& th : threads){
+		th.join();
+	}
+}
 #endif
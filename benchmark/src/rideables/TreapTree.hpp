@@ -0,0 +1,490 @@
+/*
+
+Copyright 2017 University of Rochester
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*/
+
+
+#ifndef TREAP_TREE
+#define TREAP_TREE
+
+#include <iostream>
+#include <atomic>
+#include <algorithm>
+#include <climits>
+#include "Harness.hpp"
+#include "ConcurrentPrimitives.hpp"
+#include "ROrderedMap.hpp"
+#include "RUnorderedMap.hpp"
+#include "MemoryTracker.hpp"
+#include "RetiredMonitorable.hpp"
+#include "LLXSCX.hpp"
+
+#ifdef NGC
+#define COLLECT false
+#else
+#define COLLECT true
+#endif
+
+/*
+ * A balanced lock-free external BST built with the LLX/SCX tree
+ * update template of Brown et al. [PPoPP'14]. Balance is randomized:
+ * every internal node gets a random priority and the tree is kept in
+ * (relaxed) heap order by rotations, so the expected depth is
+ * O(log n) regardless of the key order.
+ *
+ * An insert that breaks heap order with its parent leaves a violation
+ * behind and then fixes violations on its search path by rotations,
+ * like the rebalancing steps of the chromatic tree. Deletes never
+ * create violations. Every update replaces a small subtree with new
+ * copies and retires the nodes it removes.
+ */
+template <class K, class V>
+class TreapTree : public ROrderedMap<K,V>, public RetiredMonitorable{
+private:
+	/* structs*/
+	struct Node{
+		int level;//-1 for keys, 1 for the infinite leaf and its ancestors, 2 for root
+		bool leaf;
+		uint32_t pri;
+		K key;
+		V val;
+		std::atomic<Node*> child[2];
+		std::atomic<uint64_t> info;
+		std::atomic<bool> marked;
+
+		inline bool deletable() {return true;}
+		Node(K k, V v, int lev, bool lf, uint32_t pr, Node* l, Node* r):
+			level(lev),leaf(lf),pri(pr),key(k),val(v),info(0),marked(false){
+			child[0].store(l,std::memory_order_relaxed);
+			child[1].store(r,std::memory_order_relaxed);
+		};
+	};
+	struct SeekRecord{
+		Node* gp;
+		Node* p;
+		Node* l;
+	};
+	enum UpdateMode {INSERT, PUT, REPLACE};
+
+	/* variables */
+	MemoryTracker<Node>* memory_tracker;
+	LLXSCX<Node,3>* prim;
+	K infK{};
+	V defltV{};
+	Node* root;
+	padded<uint32_t>* seeds;
+
+	const int kGp = 0;
+	const int kP = 1;
+	const int kL = 2;
+	const int kNext = 3;
+	const int kHelp = 4;//3 slots for helping an SCX
+	//reservation slots of rangeScan: the current node, its child, and a
+	//stack of the deepest SCAN_DEPTH nodes whose right subtree is pending.
+	static const int SCAN_DEPTH = 8;
+	static const int SCAN_CUR = 0;
+	static const int SCAN_CHILD = 1;
+	static const int SCAN_STACK = 2;
+
+	/* helper functions */
+	inline Node* mkNode(K k, V v, int lev, bool lf, uint32_t pr, Node* l, Node* r, int tid){
+		void* ptr = memory_tracker->alloc(tid);
+		return new (ptr) Node(k,v,lev,lf,pr,l,r);
+	}
+	inline Node* copyNode(Node* n, Node* l, Node* r, int tid){
+		return mkNode(n->key,n->val,n->level,n->leaf,n->pri,l,r,tid);
+	}
+	inline uint32_t nextPri(int tid){
+		// xorshift32
+		uint32_t x = seeds[tid].ui;
+		x ^= x << 13;
+		x ^= x >> 17;
+		x ^= x << 5;
+		seeds[tid].ui = x;
+		return x;
+	}
+	//0 to go left, 1 to go right
+	inline int dirOf(K& key, Node* n){
+		if(n->level!=-1) return 0;
+		return key<n->key? 0:1;
+	}
+	inline bool isKey(Node* n, K& key){
+		return n->level==-1 && n->key==key;
+	}
+	inline int childDir(Node** snapshot, Node* c){
+		if(snapshot[0]==c) return 0;
+		if(snapshot[1]==c) return 1;
+		return -1;
+	}
+
+	/* private interfaces */
+	bool search(K key, int tid, SeekRecord& rec, bool violation);
+	bool rotate(SeekRecord& rec, int tid);
+	void cleanup(K key, int tid);
+	optional<V> update(K key, V val, UpdateMode mode, bool& inserted, int tid);
+	bool doRangeScan(K& lo, const K& hi, bool& exclusive, int& cnt, RangeVisitor<K,V>* visitor, int tid);
+public:
+	TreapTree(GlobalTestConfig* gtc): RetiredMonitorable(gtc){
+		int epochf = gtc->getEnv("epochf").empty()? 150:stoi(gtc->getEnv("epochf"));
+		int emptyf = gtc->getEnv("emptyf").empty()? 30:stoi(gtc->getEnv("emptyf"));
+		memory_tracker = new MemoryTracker<Node>(gtc, epochf, emptyf, std::max(7,SCAN_STACK+SCAN_DEPTH), COLLECT);
+		monitor(memory_tracker);
+		prim = new LLXSCX<Node,3>(gtc, memory_tracker, kHelp);
+		seeds = new padded<uint32_t>[gtc->task_num];
+		for(int i=0;i<gtc->task_num;i++){
+			seeds[i].ui = 2654435761U*(i+1);
+		}
+		Node* infLeaf = mkNode(infK,defltV,1,true,0,nullptr,nullptr,0);
+		root = mkNode(infK,defltV,2,false,UINT_MAX,infLeaf,nullptr,0);
+	};
+	~TreapTree(){};
+
+	optional<V> get(K key, int tid);
+	optional<V> put(K key, V val, int tid);
+	bool insert(K key, V val, int tid);
+	optional<V> remove(K key, int tid);
+	optional<V> replace(K key, V val, int tid);
+	std::map<K, V> rangeQuery(K key1, K key2, int& len, int tid);
+	int rangeScan(K key1, K key2, RangeVisitor<K,V>* visitor, int tid);
+};
+
+template <class K, class V>
+class TreapTreeFactory : public RideableFactory{
+	TreapTree<K,V>* build(GlobalTestConfig* gtc){
+		return new TreapTree<K,V>(gtc);
+	}
+};
+
+//-------Definition----------
+/*
+ * Finds the leaf for key and leaves gp, p and l reserved in slots
+ * kGp, kP and kL. With violation set, stops early and returns true
+ * at the first internal node l whose priority is above its parent's.
+ */
+template <class K, class V>
+bool TreapTree<K,V>::search(K key, int tid, SeekRecord& rec, bool violation){
+	while(true){
+		Node* gp=nullptr;
+		Node* p=root;//never retired
+		Node* l=memory_tracker->read(root->child[0],kL,tid,root);
+		bool restart=false;
+		while(!l->leaf){
+			Node* next=memory_tracker->read(l->child[dirOf(key,l)],kNext,tid,l);
+			/*
+			 * l is still in the tree, so next was not retired
+			 * before we reserved it.
+			 */
+			if(l->marked.load()){
+				restart=true;
+				break;
+			}
+			memory_tracker->transfer(kP,kGp,tid);
+			memory_tracker->transfer(kL,kP,tid);
+			memory_tracker->transfer(kNext,kL,tid);
+			gp=p;
+			p=l;
+			l=next;
+			if(violation && !l->leaf && l->pri>p->pri){
+				rec.gp=gp;
+				rec.p=p;
+				rec.l=l;
+				return true;
+			}
+		}
+		if(restart) continue;
+		rec.gp=gp;
+		rec.p=p;
+		rec.l=l;
+		return false;
+	}
+}
+
+/* rotates rec.l above its parent rec.p */
+template <class K, class V>
+bool TreapTree<K,V>::rotate(SeekRecord& rec, int tid){
+	typedef typename LLXSCX<Node,3>::LLXResult LLXResult;
+	const LLXResult ok = LLXSCX<Node,3>::LLX_SNAPSHOT;
+	Node* nodes[3]={rec.gp,rec.p,rec.l};
+	Node* gp=rec.gp;
+	Node* p=rec.p;
+	Node* x=rec.l;
+	uint64_t infos[3];
+	Node* gsnap[2];
+	Node* psnap[2];
+	Node* xsnap[2];
+
+	if(prim->llx(gp,gsnap,2,&infos[0],tid)!=ok) return false;
+	int gdir=childDir(gsnap,p);
+	if(gdir<0) return false;
+	if(prim->llx(p,psnap,2,&infos[1],tid)!=ok) return false;
+	int dir=childDir(psnap,x);
+	if(dir<0) return false;
+	if(prim->llx(x,xsnap,2,&infos[2],tid)!=ok) return false;
+
+	Node* pcopy=nullptr;
+	Node* xcopy=nullptr;
+	if(dir==0){//right rotation
+		pcopy=copyNode(p,xsnap[1],psnap[1],tid);
+		xcopy=copyNode(x,xsnap[0],pcopy,tid);
+	}
+	else{//left rotation
+		pcopy=copyNode(p,psnap[0],xsnap[0],tid);
+		xcopy=copyNode(x,pcopy,xsnap[1],tid);
+	}
+	if(prim->scx(nodes,infos,3,0x6,&gp->child[gdir],p,xcopy,tid)){
+		memory_tracker->retire(p,tid);
+		memory_tracker->retire(x,tid);
+		return true;
+	}
+	memory_tracker->reclaim(pcopy,tid);
+	memory_tracker->reclaim(xcopy,tid);
+	return false;
+}
+
+/* fixes heap order violations on the search path for key */
+template <class K, class V>
+void TreapTree<K,V>::cleanup(K key, int tid){
+	SeekRecord rec;
+	while(search(key,tid,rec,true)){
+		rotate(rec,tid);
+	}
+}
+
+template <class K, class V>
+optional<V> TreapTree<K,V>::update(K key, V val, UpdateMode mode, bool& inserted, int tid){
+	typedef typename LLXSCX<Node,3>::LLXResult LLXResult;
+	const LLXResult ok = LLXSCX<Node,3>::LLX_SNAPSHOT;
+	optional<V> res={};
+	SeekRecord rec;
+	Node* newLeaf=mkNode(key,val,-1,true,0,nullptr,nullptr,tid);
+	inserted=false;
+	collect_retired_size(memory_tracker->get_retired_cnt(tid), tid);
+	memory_tracker->start_op(tid);
+	while(true){
+		search(key,tid,rec,false);
+		Node* p=rec.p;
+		Node* l=rec.l;
+		bool exists=isKey(l,key);
+		if((exists && mode==INSERT) || (!exists && mode==REPLACE)){
+			memory_tracker->reclaim(newLeaf,tid);
+			break;
+		}
+
+		Node* nodes[2]={p,l};
+		uint64_t infos[2];
+		Node* psnap[2];
+		Node* lsnap[2];
+		if(prim->llx(p,psnap,2,&infos[0],tid)!=ok) continue;
+		int dir=childDir(psnap,l);
+		if(dir<0) continue;
+		if(prim->llx(l,lsnap,2,&infos[1],tid)!=ok) continue;
+
+		if(exists){//swap in the new leaf
+			if(prim->scx(nodes,infos,2,0x2,&p->child[dir],l,newLeaf,tid)){
+				res=l->val;
+				memory_tracker->retire(l,tid);
+				break;
+			}
+			continue;
+		}
+
+		/* replace l by an internal node over newLeaf and a copy of l */
+		uint32_t pri=nextPri(tid);
+		Node* lcopy=copyNode(l,nullptr,nullptr,tid);
+		Node* newInternal=nullptr;
+		if(l->level!=-1)
+			newInternal=mkNode(infK,defltV,l->level,false,pri,newLeaf,lcopy,tid);
+		else if(key<l->key)
+			newInternal=mkNode(l->key,defltV,-1,false,pri,newLeaf,lcopy,tid);
+		else
+			newInternal=mkNode(key,defltV,-1,false,pri,lcopy,newLeaf,tid);
+		if(prim->scx(nodes,infos,2,0x2,&p->child[dir],l,newInternal,tid)){
+			memory_tracker->retire(l,tid);
+			inserted=true;
+			if(pri>p->pri){
+				cleanup(key,tid);
+			}
+			break;
+		}
+		memory_tracker->reclaim(lcopy,tid);
+		memory_tracker->reclaim(newInternal,tid);
+	}
+	memory_tracker->clear_all(tid);
+	memory_tracker->end_op(tid);
+	return res;
+}
+
+template <class K, class V>
+optional<V> TreapTree<K,V>::get(K key, int tid){
+	optional<V> res={};
+	SeekRecord rec;
+	collect_retired_size(memory_tracker->get_retired_cnt(tid), tid);
+	memory_tracker->start_op(tid);
+	search(key,tid,rec,false);
+	if(isKey(rec.l,key)){
+		res=rec.l->val;
+	}
+	memory_tracker->clear_all(tid);
+	memory_tracker->end_op(tid);
+	return res;
+}
+
+template <class K, class V>
+optional<V> TreapTree<K,V>::put(K key, V val, int tid){
+	bool inserted;
+	return update(key,val,PUT,inserted,tid);
+}
+
+template <class K, class V>
+bool TreapTree<K,V>::insert(K key, V val, int tid){
+	bool inserted;
+	update(key,val,INSERT,inserted,tid);
+	return inserted;
+}
+
+template <class K, class V>
+optional<V> TreapTree<K,V>::replace(K key, V val, int tid){
+	bool inserted;
+	return update(key,val,REPLACE,inserted,tid);
+}
+
+template <class K, class V>
+optional<V> TreapTree<K,V>::remove(K key, int tid){
+	typedef typename LLXSCX<Node,3>::LLXResult LLXResult;
+	const LLXResult ok = LLXSCX<Node,3>::LLX_SNAPSHOT;
+	optional<V> res={};
+	SeekRecord rec;
+	collect_retired_size(memory_tracker->get_retired_cnt(tid), tid);
+	memory_tracker->start_op(tid);
+	while(true){
+		search(key,tid,rec,false);
+		Node* gp=rec.gp;
+		Node* p=rec.p;
+		Node* l=rec.l;
+		if(!isKey(l,key)){
+			break;
+		}
+
+		/* replace p by the sibling of l */
+		Node* nodes[3]={gp,p,l};
+		uint64_t infos[3];
+		Node* gsnap[2];
+		Node* psnap[2];
+		Node* lsnap[2];
+		if(prim->llx(gp,gsnap,2,&infos[0],tid)!=ok) continue;
+		int gdir=childDir(gsnap,p);
+		if(gdir<0) continue;
+		if(prim->llx(p,psnap,2,&infos[1],tid)!=ok) continue;
+		int dir=childDir(psnap,l);
+		if(dir<0) continue;
+		if(prim->llx(l,lsnap,2,&infos[2],tid)!=ok) continue;
+		if(prim->scx(nodes,infos,3,0x6,&gp->child[gdir],p,psnap[1-dir],tid)){
+			res=l->val;
+			memory_tracker->retire(p,tid);
+			memory_tracker->retire(l,tid);
+			break;
+		}
+	}
+	memory_tracker->clear_all(tid);
+	memory_tracker->end_op(tid);
+	return res;
+}
+
+template <class K, class V>
+std::map<K, V> TreapTree<K,V>::rangeQuery(K key1, K key2, int& len, int tid){
+	RangeCollector<K,V> collector;
+	len=rangeScan(key1,key2,&collector,tid);
+	return collector.res;
+}
+
+template <class K, class V>
+int TreapTree<K,V>::rangeScan(K key1, K key2, RangeVisitor<K,V>* visitor, int tid){
+	if(key1>key2) return 0;
+	K lo=key1;//scan cursor
+	bool exclusive=false;
+	int cnt=0;
+
+	collect_retired_size(memory_tracker->get_retired_cnt(tid), tid);
+	memory_tracker->start_op(tid);
+	while(!doRangeScan(lo,key2,exclusive,cnt,visitor,tid)){}
+	memory_tracker->clear_all(tid);
+	memory_tracker->end_op(tid);
+	return cnt;
+}
+
+/*
+ * Iterative in-order walk from root, resuming after the cursor lo.
+ * As in search(), a child read from a reserved node that is still
+ * unmarked afterwards was in the tree at the read, so it was not
+ * retired before being reserved; this holds under Hazard, HE and WFE
+ * alike. A marked node means the walk is off the tree, and it restarts
+ * from the cursor, as it does when the stack of pending right
+ * subtrees overflowed and runs dry. Returns false on restart.
+ */
+template <class K, class V>
+bool TreapTree<K,V>::doRangeScan(K& lo, const K& hi, bool& exclusive, int& cnt, RangeVisitor<K,V>* visitor, int tid){
+	Node* stack[SCAN_DEPTH];
+	int top=0;
+	int bottom=0;
+	Node* n=root;//never retired or marked
+	while(true){
+		Node* child;
+		if(n!=nullptr){
+			/* descend towards the first key after the cursor */
+			if(n->level!=-1 || lo<n->key){
+				child=memory_tracker->read(n->child[0],SCAN_CHILD,tid,n);
+				if(n->level==-1 && !(hi<n->key)){
+					if(top-bottom==SCAN_DEPTH)
+						bottom++;
+					stack[top%SCAN_DEPTH]=n;
+					memory_tracker->transfer(SCAN_CUR,SCAN_STACK+top%SCAN_DEPTH,tid);
+					top++;
+				}
+			}
+			else{
+				child=memory_tracker->read(n->child[1],SCAN_CHILD,tid,n);
+			}
+			if(n->marked.load())
+				return false;
+		}
+		else{
+			/* go on with the closest pending right subtree */
+			if(top==bottom)
+				return bottom==0;
+			top--;
+			Node* pending=stack[top%SCAN_DEPTH];
+			child=memory_tracker->read(pending->child[1],SCAN_CHILD,tid,pending);
+			if(pending->marked.load())
+				return false;
+		}
+
+		if(!child->leaf){
+			memory_tracker->transfer(SCAN_CHILD,SCAN_CUR,tid);
+			n=child;
+			continue;
+		}
+		if(child->level!=-1 || hi<child->key)
+			return true;//the infinite leaf or past hi
+		if(lo<child->key || (!exclusive && !(child->key<lo))){
+			visitor->visit(child->key,child->val);
+			cnt++;
+			lo=child->key;
+			exclusive=true;
+		}
+		n=nullptr;
+	}
+}
+#endif
@@ -0,0 +1,236 @@
+/*
+
+Copyright 2017 University of Rochester
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*/
+
+#ifndef _TREIBERSTACK_H_
+#define _TREIBERSTACK_H_
+
+#include <atomic>
+#include "Harness.hpp"
+#include "ConcurrentPrimitives.hpp"
+#include "RUnorderedMap.hpp"
+#include "MemoryTracker.hpp"
+#include "RetiredMonitorable.hpp"
+#include <stdexcept>
+#include <cstdlib>
+
+#ifdef NGC
+#define COLLECT false
+#else
+#define COLLECT true
+#endif
+
+/**
+ * Treiber lock-free stack [IBM RJ 5118] with an elimination-backoff
+ * array [Hendler, Shavit, Yerushalmi; SPAA'04].
+ *
+ * insert() pushes and remove() pops, in the same way as the queues.
+ * Every successful pop retires one node, so the workload stresses
+ * retire() and empty() around a single hot pointer.
+ *
+ * A push that loses the CAS on top offers its node in a random
+ * exchanger slot and waits a little; a pop that loses the CAS on top
+ * tries to take an offered node from a random slot. Exchanger slots
+ * hold ordinary nodes, so they are protected and retired through the
+ * same MemoryTracker. The width of the array is set with -d elim=N
+ * (0 disables elimination), and defaults to half the thread count.
+ */
+template <class K, class V>
+class TreiberStack : public RUnorderedMap<K, V>, public RetiredMonitorable {
+
+private:
+    struct Node {
+        V item;
+        std::atomic<Node*> next;
+
+        Node() : next{nullptr} { }
+
+        Node(V _item) : item{_item}, next{nullptr} { }
+
+        inline bool deletable() {return true;}
+    };
+
+    // Marks an exchanger slot whose node was taken by a pop
+    Node* const taken_node = (Node*) 0x1;
+    static const int ELIM_SPINS = 128;
+
+    MemoryTracker<Node>* memory_tracker;
+
+    // To make sure we are not affected by the misaligned object
+    alignas(128) int __pad1;
+
+    alignas(128) std::atomic<Node*> top;
+
+    // To make sure we are not affected by the misaligned object
+    alignas(128) int __pad2;
+
+    int elim_width;
+    paddedAtomic<Node*>* elim_array;
+    padded<uint32_t>* seeds;
+
+    const int kHpTop = 0;
+    const int kHpElim = 1;
+
+    inline int randomSlot(int tid) {
+        // xorshift32
+        uint32_t x = seeds[tid].ui;
+        x ^= x << 13;
+        x ^= x >> 17;
+        x ^= x << 5;
+        seeds[tid].ui = x;
+        return x % elim_width;
+    }
+
+    /**
+     * Offer myNode in a random slot. Returns true if a pop took it,
+     * false if nobody came and the offer was withdrawn.
+     */
+    bool eliminatePush(Node* myNode, int tid) {
+        if (elim_width == 0) return false;
+        std::atomic<Node*>& slot = elim_array[randomSlot(tid)].ui;
+        Node* expected = nullptr;
+        if (!slot.compare_exchange_strong(expected, myNode)) return false;
+        for (int i = 0; i < ELIM_SPINS; i++) {
+            if (slot.load(std::memory_order_acquire) != myNode) break;
+        }
+        expected = myNode;
+        if (slot.compare_exchange_strong(expected, nullptr)) return false;
+        // A pop replaced myNode with taken_node; free up the slot
+        slot.store(nullptr, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * Take a node offered by a push, if there is one in a random slot.
+     * The node never became reachable from top, so the pop that takes
+     * it is the only one to retire it.
+     */
+    Node* eliminatePop(int tid) {
+        if (elim_width == 0) return nullptr;
+        std::atomic<Node*>& slot = elim_array[randomSlot(tid)].ui;
+        for (int i = 0; i < ELIM_SPINS; i++) {
+            Node* offered = memory_tracker->read(slot, kHpElim, tid, nullptr);
+            if (offered == nullptr || offered == taken_node) continue;
+            if (slot.compare_exchange_strong(offered, taken_node)) return offered;
+            return nullptr;
+        }
+        return nullptr;
+    }
+
+public:
+    TreiberStack(GlobalTestConfig* gtc): RetiredMonitorable(gtc) {
+        int epochf = gtc->getEnv("epochf").empty()? 150:stoi(gtc->getEnv("epochf"));
+        int emptyf = gtc->getEnv("emptyf").empty()? 30:stoi(gtc->getEnv("emptyf"));
+        std::cout<<"emptyf:"<<emptyf<<std::endl;
+        elim_width = gtc->getEnv("elim").empty()? gtc->task_num/2:stoi(gtc->getEnv("elim"));
+        if (elim_width < 0) errexit("TreiberStack: elim must be non-negative.");
+        memory_tracker = new MemoryTracker<Node>(gtc, epochf, emptyf, 2, COLLECT);
+        monitor(memory_tracker);
+        elim_array = new paddedAtomic<Node*>[elim_width > 0 ? elim_width : 1];
+        for (int i = 0; i < elim_width; i++) {
+            elim_array[i].ui.store(nullptr, std::memory_order_relaxed);
+        }
+        seeds = new padded<uint32_t>[gtc->task_num];
+        for (int i = 0; i < gtc->task_num; i++) {
+            seeds[i].ui = 2654435761U * (i + 1);
+        }
+        top.store(nullptr, std::memory_order_relaxed);
+    }
+
+    ~TreiberStack() {
+        optional<V> nullres={};
+        elim_width = 0;
+        while (remove(0, 0) != nullres); // Drain the stack
+        delete[] elim_array;
+        delete[] seeds;
+    }
+
+    Node* mkNode(V item, int tid){
+        void* ptr = memory_tracker->alloc(tid);
+        return new (ptr) Node(item);
+    }
+
+    bool insert(K __key, V item, int tid) {
+        Node* myNode = mkNode(item, tid);
+        collect_retired_size(memory_tracker->get_retired_cnt(tid), tid);
+        memory_tracker->start_op(tid);
+        while (true) {
+            Node* ltop = top.load(std::memory_order_acquire);
+            myNode->next.store(ltop, std::memory_order_relaxed);
+            if (top.compare_exchange_strong(ltop, myNode)) break;
+            if (eliminatePush(myNode, tid)) break;
+        }
+        memory_tracker->end_op(tid);
+        memory_tracker->clear_all(tid);
+        return true;
+    }
+
+    optional<V> remove(K __key, int tid) {
+        optional<V> res={};
+        collect_retired_size(memory_tracker->get_retired_cnt(tid), tid);
+        memory_tracker->start_op(tid);
+        while (true) {
+            Node* ltop = memory_tracker->read(top, kHpTop, tid, nullptr);
+            if (ltop == nullptr) break; // Stack is empty
+            Node* lnext = ltop->next.load(std::memory_order_acquire);
+            if (top.compare_exchange_strong(ltop, lnext)) {
+                res = ltop->item;
+                memory_tracker->retire(ltop, tid);
+                break;
+            }
+            Node* offered = eliminatePop(tid);
+            if (offered != nullptr) {
+                res = offered->item;
+                memory_tracker->retire(offered, tid);
+                break;
+            }
+        }
+        memory_tracker->end_op(tid);
+        memory_tracker->clear_all(tid);
+        return res;
+    }
+
+public:
+    optional<V> get(K key, int tid)
+    {
+        optional<V> res={};
+        return res;
+    }
+
+    optional<V> put(K key, V val, int tid)
+    {
+        optional<V> res={};
+        return res;
+    }
+
+    optional<V> replace(K key, V val, int tid)
+    {
+        optional<V> res={};
+        return res;
+    }
+};
+
+template <class K, class V>
+class TreiberStackFactory : public RideableFactory {
+    TreiberStack<K,V>* build(GlobalTestConfig* gtc) {
+        // C++11 new ignores the 128-byte alignment of top
+        void* ptr = aligned_alloc(alignof(TreiberStack<K,V>), sizeof(TreiberStack<K,V>));
+        return new (ptr) TreiberStack<K,V>(gtc);
+    }
+};
+
+#endif /* _TREIBERSTACK_H_ */
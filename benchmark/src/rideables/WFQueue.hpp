@@ -131,6 +131,7 @@ public:
         int emptyf = gtc->getEnv("emptyf").empty()? 30:stoi(gtc->getEnv("emptyf"));
         std::cout<<"emptyf:"<<emptyf<<std::endl;
         memory_tracker = new MemoryTracker<Node>(gtc, epochf, emptyf, 5, COLLECT);
+        monitor(memory_tracker);
         memory_tracker->start_op(0);
         OPDESC_END = mkOpDesc(IDX_NONE, false, true, nullptr, 0);
         Node* sentinelNode = mkNode(0);
@@ -32,23 +32,48 @@ limitations under the License.
 template<class T> class BaseTracker{
 public:
 	padded<uint64_t>* retired_cnt;
+	padded<uint64_t>* retired_bytes;
+	// bytes of the block alloc() returns for one T
+	size_t block_bytes = sizeof(T);
 
 	BaseTracker(int task_num){
 		retired_cnt = new padded<uint64_t>[task_num];
+		retired_bytes = new padded<uint64_t>[task_num];
 		for(int i = 0 ; i<task_num; i++){
 			retired_cnt[i].ui = 0;
+			retired_bytes[i].ui = 0;
 		}
 	}
 
 	uint64_t get_retired_cnt(int tid){
 		return retired_cnt[tid].ui;
 	}
+	uint64_t get_retired_bytes(int tid){
+		return retired_bytes[tid].ui;
+	}
 
-	void inc_retired(int tid){
+	void inc_retired(T* obj, int tid){
 		retired_cnt[tid].ui++;
+		retired_bytes[tid].ui += freed_bytes(obj);
 	}
-	void dec_retired(int tid){
+	// before obj is reclaimed
+	void dec_retired(T* obj, int tid){
 		retired_cnt[tid].ui--;
+		retired_bytes[tid].ui -= freed_bytes(obj);
+	}
+
+	// bytes freed with a retired object: its block, and whatever else
+	// its destructor frees, for node types that define retiredBytes()
+	size_t freed_bytes(T* obj){
+		return block_bytes + extra_bytes(obj, 0);
+	}
+	template<class U>
+	static auto extra_bytes(U* obj, int) -> decltype((size_t)obj->retiredBytes()){
+		return obj->retiredBytes();
+	}
+	template<class U>
+	static size_t extra_bytes(U* obj, long){
+		return 0;
 	}
 
 	virtual void* alloc(int tid){
@@ -87,6 +112,29 @@ public:
 	virtual void clear_all(int tid){}
 
 	virtual void retire(T* obj, int tid){}
+
+	// reclaims what it can of thread tid's retired objects
+	virtual void empty(int tid){}
+
+	// current epoch, for trackers that keep one; read by the stats
+	// sampler only, so the trackers' own getEpoch() stays non-virtual
+	virtual uint64_t statEpoch(){
+		return 0;
+	}
+
+	// advances the epoch on behalf of thread tid, doing whatever the
+	// tracker does before its own increments; for the epoch-storm test,
+	// so the trackers' own incrementEpoch() stays non-virtual
+	virtual void stormAdvance(int tid){}
+
+	// slow-path entries of reads by thread tid, and reads of other
+	// threads it has helped, for trackers with a wait-free slow path
+	virtual uint64_t get_slow_paths(int tid){
+		return 0;
+	}
+	virtual uint64_t get_helps(int tid){
+		return 0;
+	}
 };
 
 #endif
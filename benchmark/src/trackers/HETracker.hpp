@@ -64,6 +64,7 @@ public:
 	// therefore emptyFreq is somewhat different. Use epochFreq+emptyFreq
 	// for retire()'s frequency for now.
 	 BaseTracker<T>(task_num),task_num(task_num),he_num(he_num),epochFreq(epochFreq),freq(epochFreq+emptyFreq),collect(collect){
+		this->block_bytes = sizeof(uint64_t) + sizeof(T);//birth epoch after T
 		retired = new padded<std::list<HETracker<T>::HEInfo>>[task_num];
 		reservations = new padded<std::atomic<uint64_t>*>[task_num];
 		for (int i = 0; i<task_num; i++){
@@ -84,6 +85,9 @@ public:
 	uint64_t getEpoch(){
 		return epoch.ui.load(std::memory_order_acquire);
 	}
+	uint64_t statEpoch(){
+		return getEpoch();
+	}
 
 	void* alloc(int tid){
 		alloc_counters[tid] = alloc_counters[tid]+1;
@@ -140,6 +144,9 @@ public:
 	inline void incrementEpoch(){
 		epoch.ui.fetch_add(1,std::memory_order_acq_rel);
 	}
+	void stormAdvance(int tid){
+		incrementEpoch();
+	}
 	
 	void retire(T* obj, int tid){
 		if(obj==NULL){return;}
@@ -180,9 +187,9 @@ public:
 		for (auto iterator = myTrash->begin(), end = myTrash->end(); iterator != end; ) {
 			HEInfo res = *iterator;
 			if(res.obj->deletable() && can_delete(res.birth_epoch, res.retire_epoch)){
+				this->dec_retired(res.obj, tid);
 				reclaim(res.obj);
 				iterator = myTrash->erase(iterator);
-				this->dec_retired(tid);
 			}
 			else{++iterator;}
 		}
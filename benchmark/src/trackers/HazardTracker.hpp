@@ -63,8 +63,8 @@ private:
 			}
 			}
 			if(!danger){
+				this->dec_retired(ptr, tid);
 				this->reclaim(ptr);
-				this->dec_retired(tid);
 				iterator = myTrash->erase(iterator);
 			}
 			else{++iterator;}
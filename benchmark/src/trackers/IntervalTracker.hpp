@@ -62,6 +62,7 @@ public:
 	~IntervalTracker(){};
 	IntervalTracker(int task_num, int epochFreq, int emptyFreq, bool collect): 
 	 BaseTracker<T>(task_num),task_num(task_num),freq(emptyFreq),epochFreq(epochFreq),collect(collect){
+		this->block_bytes = sizeof(uint64_t) + sizeof(T);//birth epoch after T
 		retired = new padded<std::list<IntervalTracker<T>::IntervalInfo>>[task_num];
 		reservations = new paddedAtomic<uint64_t>[task_num];
 		retire_counters = new padded<uint64_t>[task_num];
@@ -81,6 +82,9 @@ public:
 	uint64_t getEpoch(){
 		return epoch.load(std::memory_order_acquire);
 	}
+	uint64_t statEpoch(){
+		return getEpoch();
+	}
 	void* alloc(int tid){
 		alloc_counters[tid]=alloc_counters[tid]+1;
 		if(alloc_counters[tid]%(epochFreq*task_num)==0){
@@ -123,6 +127,9 @@ public:
 	inline void incrementEpoch(){
 		epoch.fetch_add(1,std::memory_order_acq_rel);
 	}
+	void stormAdvance(int tid){
+		incrementEpoch();
+	}
 	
 	
 	void retire(T* obj, uint64_t birth_epoch, int tid){
@@ -167,8 +174,8 @@ public:
 			IntervalInfo res = *iterator;
 			if(res.obj->deletable() && !conflict(reservEpoch, res.birth_epoch, res.retire_epoch)){
 				iterator = myTrash->erase(iterator);
+				this->dec_retired(res.obj, tid);
 				this->reclaim(res.obj);
-				this->dec_retired(tid);
 			}
 			else{++iterator;}
 		}
@@ -58,15 +58,35 @@ enum TrackerType{
 	WFE = 7
 };
 
+// Tracker state that a sampler thread may read during a run.
+// The reads are not synchronized with the workers, so the values
+// are only approximate.
+class TrackerStats{
+public:
+	// objects retired but not yet reclaimed, over all threads
+	virtual uint64_t unreclaimed()=0;
+	virtual uint64_t unreclaimed_bytes()=0;
+	virtual uint64_t epoch()=0;
+	// per-thread counts of the wait-free slow path, see BaseTracker
+	virtual uint64_t slow_paths(int tid)=0;
+	virtual uint64_t helps(int tid)=0;
+	// per-thread count of read() calls, a measure of path length
+	virtual uint64_t reads(int tid)=0;
+	// lets a test drive the epoch, as the storm test does
+	virtual void advance_epoch(int tid)=0;
+};
+
 template<class T>
-class MemoryTracker{
+class MemoryTracker : public TrackerStats{
 private:
 	BaseTracker<T>* tracker = NULL;
 	TrackerType type = NIL;
 	padded<int*>* slot_renamers = NULL;
+	padded<uint64_t>* read_cnt = NULL;
+	int task_num;
 public:
 	MemoryTracker(GlobalTestConfig* gtc, int epoch_freq, int empty_freq, int slot_num, bool collect){
-		int task_num = gtc->task_num;
+		task_num = gtc->task_num;
 		std::string tracker_type = gtc->getEnv("tracker");
 		if (tracker_type.empty()){
 			tracker_type = "RCU";
@@ -74,11 +94,13 @@ public:
 		}
 
 		slot_renamers = new padded<int*>[task_num];
+		read_cnt = new padded<uint64_t>[task_num];
 		for (int i = 0; i < task_num; i++){
 			slot_renamers[i].ui = new int[slot_num];
 			for (int j = 0; j < slot_num; j++){
 				slot_renamers[i].ui[j] = j;
 			}
+			read_cnt[i].ui = 0;
 		}
 		if (tracker_type == "NIL"){
 			tracker = new BaseTracker<T>(task_num);
@@ -97,7 +119,12 @@ public:
 			tracker = new HETracker<T>(task_num, slot_num, epoch_freq, empty_freq, collect);
 			type = HE;
 		} else if (tracker_type == "WFE"){
-			tracker = new WFETracker<T>(task_num, slot_num, epoch_freq, empty_freq, collect);
+			// -d attempts=<n> bounds the fast-path reads before the slow path
+			int attempts = gtc->checkEnv("attempts")? atoi(gtc->getEnv("attempts").c_str()) : 16;
+			if (attempts < 1){
+				errexit("constructor - attempts must be at least 1.");
+			}
+			tracker = new WFETracker<T>(task_num, slot_num, epoch_freq, empty_freq, collect, attempts);
 			type = WFE;
 		} else if (tracker_type == "QSBR"){
 			tracker = new RCUTracker<T>(task_num, epoch_freq, empty_freq, type_QSBR, collect);
@@ -150,6 +177,7 @@ public:
 	}
 
 	T* read(std::atomic<T*>& obj, int idx, int tid, T* node){
+		read_cnt[tid].ui++;
 		return tracker->read(obj, slot_renamers[tid].ui[idx], tid, node);
 	}
 
@@ -172,10 +200,14 @@ public:
 	}
 
 	void retire(T* obj, int tid){
-		tracker->inc_retired(tid);
+		tracker->inc_retired(obj, tid);
 		tracker->retire(obj, tid);
 	}
 
+	void empty(int tid){
+		tracker->empty(tid);
+	}
+
 	uint64_t get_retired_cnt(int tid){
 		if (type){
 			return tracker->get_retired_cnt(tid);
@@ -183,6 +215,50 @@ public:
 			return 0;
 		}
 	}
+
+	uint64_t unreclaimed(){
+		uint64_t sum = 0;
+		for (int i = 0; i < task_num; i++){
+			sum += get_retired_cnt(i);
+		}
+		return sum;
+	}
+
+	uint64_t get_retired_bytes(int tid){
+		if (type){
+			return tracker->get_retired_bytes(tid);
+		} else {
+			return 0;
+		}
+	}
+
+	uint64_t unreclaimed_bytes(){
+		uint64_t sum = 0;
+		for (int i = 0; i < task_num; i++){
+			sum += get_retired_bytes(i);
+		}
+		return sum;
+	}
+
+	uint64_t epoch(){
+		return tracker->statEpoch();
+	}
+
+	uint64_t slow_paths(int tid){
+		return tracker->get_slow_paths(tid);
+	}
+
+	uint64_t helps(int tid){
+		return tracker->get_helps(tid);
+	}
+
+	uint64_t reads(int tid){
+		return read_cnt[tid].ui;
+	}
+
+	void advance_epoch(int tid){
+		tracker->stormAdvance(tid);
+	}
 };
 
 
@@ -75,6 +75,10 @@ public:
 	RCUTracker(int task_num, int epochFreq, int emptyFreq, bool collect) : 
 		RCUTracker(task_num,epochFreq,emptyFreq,type_RCU,collect){}
 
+	uint64_t statEpoch(){
+		return epoch.load(std::memory_order_acquire);
+	}
+
 	void __attribute__ ((deprecated)) reserve(uint64_t e, int tid){
 		return start_op(tid);
 	}
@@ -113,6 +117,9 @@ public:
 	inline void incrementEpoch(){
 		epoch.fetch_add(1,std::memory_order_acq_rel);
 	}
+	void stormAdvance(int tid){
+		incrementEpoch();
+	}
 	
 	void __attribute__ ((deprecated)) retire(T* obj, uint64_t e, int tid){
 		return retire(obj,tid);
@@ -149,8 +156,8 @@ public:
 			RCUInfo res = *iterator;
 			if(res.obj->deletable() && res.epoch<minEpoch){
 				iterator = myTrash->erase(iterator);
+				this->dec_retired(res.obj, tid);
 				this->reclaim(res.obj);
-				this->dec_retired(tid);
 			}
 			else{++iterator;}
 		}
@@ -74,6 +74,7 @@ public:
 	~RangeTrackerTP(){};
 	RangeTrackerTP(int task_num, int epochFreq, int emptyFreq, bool collect): 
 	 BaseTracker<T>(task_num),task_num(task_num),freq(emptyFreq),epochFreq(epochFreq),collect(collect){
+		this->block_bytes = sizeof(uint64_t) + sizeof(T);//birth epoch after T
 		retired = new padded<std::list<RangeTrackerTP<T>::IntervalInfo>>[task_num];
 		upper_reservs = new paddedAtomic<uint64_t>[task_num];
 		lower_reservs = new paddedAtomic<uint64_t>[task_num];
@@ -164,6 +165,9 @@ public:
 	inline void incrementEpoch(){
 		epoch.fetch_add(1,std::memory_order_acq_rel);
 	}
+	void stormAdvance(int tid){
+		incrementEpoch();
+	}
 	
 	void retire(T* obj, uint64_t birth_epoch, int tid){
 		if(obj==NULL){return;}
@@ -208,8 +212,8 @@ public:
 		for (auto iterator = myTrash->begin(), end = myTrash->end(); iterator != end; ) {
 			IntervalInfo res = *iterator;
 			if(res.obj->deletable() && !conflict(lower_epochs_arr, upper_epochs_arr, res.birth_epoch, res.retire_epoch)){
+				this->dec_retired(res.obj, tid);
 				reclaim(res.obj);
-				this->dec_retired(tid);
 				iterator = myTrash->erase(iterator);
 			}
 			else{++iterator;}
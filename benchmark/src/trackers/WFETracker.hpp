@@ -82,6 +82,7 @@ private:
 	int epochFreq;
 	int freq;
 	bool collect;
+	int max_attempts;
 
 public:
 	struct WFESlot {
@@ -102,6 +103,8 @@ private:
 	WFESlot* reservations;
 	padded<uint64_t>* retire_counters;
 	padded<uint64_t>* alloc_counters;
+	padded<uint64_t>* slow_counters;
+	padded<uint64_t>* help_counters;
 	padded<std::list<WFEInfo>>* retired;
 	paddedAtomic<uint64_t> counter_start, counter_end;
 
@@ -109,11 +112,12 @@ private:
 
 public:
 	~WFETracker(){};
-	WFETracker(int task_num, int he_num, int epochFreq, int emptyFreq, bool collect):
+	WFETracker(int task_num, int he_num, int epochFreq, int emptyFreq, bool collect, int max_attempts = 16):
 	// Unlike EBR/IBR, Hazard Eras also increment epoch in retire() and
 	// therefore emptyFreq is somewhat different. Use epochFreq+emptyFreq
 	// for retire()'s frequency for now.
-	 BaseTracker<T>(task_num),task_num(task_num),he_num(he_num),epochFreq(epochFreq),freq(epochFreq+emptyFreq),collect(collect){
+	 BaseTracker<T>(task_num),task_num(task_num),he_num(he_num),epochFreq(epochFreq),freq(epochFreq+emptyFreq),collect(collect),max_attempts(max_attempts){
+		this->block_bytes = sizeof(uint64_t) + sizeof(T);//birth epoch after T
 		retired = new padded<std::list<WFETracker<T>::WFEInfo>>[task_num];
 		reservations = new WFESlot[task_num];
 		for (int i = 0; i<task_num; i++){
@@ -134,6 +138,12 @@ public:
 		}
 		retire_counters = new padded<uint64_t>[task_num];
 		alloc_counters = new padded<uint64_t>[task_num];
+		slow_counters = new padded<uint64_t>[task_num];
+		help_counters = new padded<uint64_t>[task_num];
+		for (int i = 0; i<task_num; i++){
+			slow_counters[i].ui = 0;
+			help_counters[i].ui = 0;
+		}
 		counter_start.ui.store(0, std::memory_order_release);
 		counter_end.ui.store(0, std::memory_order_release);
 		epoch.ui.store(1, std::memory_order_release); // use 0 as infinity
@@ -146,6 +156,9 @@ public:
 	uint64_t getEpoch(){
 		return epoch.ui.load(std::memory_order_acquire);
 	}
+	uint64_t statEpoch(){
+		return getEpoch();
+	}
 
 	inline void help_thread(int tid, int index, int mytid)
 	{
@@ -153,6 +166,7 @@ public:
 		last_result.full = dcas_load(reservations[tid].state.ui[index].result.full, std::memory_order_acquire);
 		if (last_result.pair[0] != (uint64_t) -1LL)
 			return;
+		help_counters[mytid].ui++;
 		uint64_t birth_epoch = reservations[tid].state.ui[index].epoch.load(std::memory_order_acquire);
 		reservations[mytid].slot.ui[he_num].pair[0].store(birth_epoch, std::memory_order_seq_cst);
 		std::atomic<T*> *obj = (std::atomic<T*> *) reservations[tid].state.ui[index].pointer.load(std::memory_order_acquire);
@@ -228,7 +242,7 @@ public:
 	{
 		// fast path
 		uint64_t prev_epoch = reservations[tid].slot.ui[index].pair[0].load(std::memory_order_acquire);
-		size_t attempts = 16;
+		size_t attempts = max_attempts;
 		do {
 			T* ptr = obj.load(std::memory_order_acquire);
 			uint64_t curr_epoch = getEpoch();
@@ -246,7 +260,7 @@ public:
 	void reserve_slot(T* obj, int index, int tid, T* node){
 		// fast path
 		uint64_t prev_epoch = reservations[tid].slot.ui[index].pair[0].load(std::memory_order_acquire);
-		size_t attempts = 16;
+		size_t attempts = max_attempts;
 		do {
 			uint64_t curr_epoch = getEpoch();
 			if (curr_epoch == prev_epoch){
@@ -263,6 +277,7 @@ public:
 	__attribute__((noinline)) T* slow_path(std::atomic<T*>* obj, int index, int tid, T* node)
 	{
 		// slow path
+		slow_counters[tid].ui++;
 		uint64_t prev_epoch = reservations[tid].slot.ui[index].pair[0].load(std::memory_order_acquire);
 		counter_start.ui.fetch_add(1, std::memory_order_acq_rel);
 		reservations[tid].state.ui[index].pointer.store((uint64_t) obj, std::memory_order_release);
@@ -317,6 +332,19 @@ public:
 	inline void incrementEpoch(){
 		epoch.ui.fetch_add(1, std::memory_order_acq_rel);
 	}
+
+	void stormAdvance(int tid){
+		// help other threads first, as alloc() and retire() do
+		help_read(tid);
+		incrementEpoch();
+	}
+
+	uint64_t get_slow_paths(int tid){
+		return slow_counters[tid].ui;
+	}
+	uint64_t get_helps(int tid){
+		return help_counters[tid].ui;
+	}
 	
 	void retire(T* obj, int tid){
 		if(obj==NULL){return;}
@@ -360,9 +388,9 @@ public:
 			if (res.obj->deletable() && can_delete(res.birth_epoch, res.retire_epoch, 0, he_num) && can_delete(res.birth_epoch, res.retire_epoch, he_num, he_num+1)) {
 				uint64_t cs = counter_start.ui.load(std::memory_order_acquire);
 				if (ce == cs || (can_delete(res.birth_epoch, res.retire_epoch, he_num+1, he_num+2) && can_delete(res.birth_epoch, res.retire_epoch, 0, he_num))) {
+					this->dec_retired(res.obj, tid);
 					reclaim(res.obj);
 					iterator = myTrash->erase(iterator);
-					this->dec_retired(tid);
 				}
 			}
 			else{++iterator;}